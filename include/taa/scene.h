@@ -150,4 +150,10 @@ taa_SCENE_LINKAGE void taa_scene_resize_textures(
     taa_scene* scene,
     uint32_t numtextures);
 
+/**
+ * @brief releases the unused vertex capacity of every mesh in the scene
+ */
+taa_SCENE_LINKAGE void taa_scene_shrink_to_fit(
+    taa_scene* scene);
+
 #endif // taa_SCENE_H_
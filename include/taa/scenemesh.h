@@ -13,7 +13,12 @@
 //****************************************************************************
 // constants
 
-enum { taa_SCENEMESH_NAMESIZE = 32 };
+enum
+{
+    taa_SCENEMESH_NAMESIZE = 32,
+    /// maximum number of joints influencing a vertex when skinning
+    taa_SCENEMESH_MAXINFLUENCES = 8
+};
 
 //****************************************************************************
 // enums
@@ -43,7 +48,49 @@ enum taa_scenemesh_valuetype_e
     taa_SCENEMESH_VALUE_UINT8,
     taa_SCENEMESH_VALUE_UINT16,
     taa_SCENEMESH_VALUE_UINT32,
-    taa_SCENEMESH_VALUE_MERGED
+    taa_SCENEMESH_VALUE_MERGED,
+    // the following types are appended to preserve serialized enum values
+    /// IEEE 754 binary16
+    taa_SCENEMESH_VALUE_FLOAT16,
+    /// int8_t mapping [-127, 127] to [-1, 1]
+    taa_SCENEMESH_VALUE_SNORM8,
+    /// int16_t mapping [-32767, 32767] to [-1, 1]
+    taa_SCENEMESH_VALUE_SNORM16,
+    /// uint8_t mapping [0, 255] to [0, 1]
+    taa_SCENEMESH_VALUE_UNORM8,
+    /// uint16_t mapping [0, 65535] to [0, 1]
+    taa_SCENEMESH_VALUE_UNORM16
+};
+
+enum taa_scenemesh_quantize_e
+{
+    taa_SCENEMESH_QUANTIZE_NONE,
+    /**
+     * @brief normalized integers relative to the bounds of the stream
+     * @details decoded as bias + scale * value
+     */
+    taa_SCENEMESH_QUANTIZE_BOUNDS,
+    /**
+     * @brief unit vectors as 2 component signed normalized octahedral maps
+     * @details an optional third component holds the sign of the fourth
+     *          source component, i.e. the handedness of a tangent.
+     */
+    taa_SCENEMESH_QUANTIZE_OCTAHEDRAL
+};
+
+/**
+ * @brief how often an element is read, used to plan vertex layouts
+ */
+enum taa_scenemesh_access_e
+{
+    /// hot for the position with set 0, warm for anything else
+    taa_SCENEMESH_ACCESS_DEFAULT,
+    /// read by every pass, including depth only passes
+    taa_SCENEMESH_ACCESS_HOT,
+    /// read when shading
+    taa_SCENEMESH_ACCESS_WARM,
+    /// read rarely, or only by some passes
+    taa_SCENEMESH_ACCESS_COLD
 };
 
 //****************************************************************************
@@ -51,11 +98,19 @@ enum taa_scenemesh_valuetype_e
 
 typedef enum taa_scenemesh_usage_e taa_scenemesh_usage;
 typedef enum taa_scenemesh_valuetype_e taa_scenemesh_valuetype;
+typedef enum taa_scenemesh_quantize_e taa_scenemesh_quantize;
+typedef enum taa_scenemesh_access_e taa_scenemesh_access;
 
+typedef struct taa_scenemesh_arena_s taa_scenemesh_arena;
+typedef struct taa_scenemesh_builder_s taa_scenemesh_builder;
 typedef struct taa_scenemesh_vertformat_s taa_scenemesh_vertformat;
 typedef struct taa_scenemesh_face_s taa_scenemesh_face;
 typedef struct taa_scenemesh_skinjoint_s taa_scenemesh_skinjoint;
+typedef struct taa_scenemesh_bounds_s taa_scenemesh_bounds;
 typedef struct taa_scenemesh_binding_s taa_scenemesh_binding;
+typedef struct taa_scenemesh_meshlet_s taa_scenemesh_meshlet;
+typedef struct taa_scenemesh_lod_s taa_scenemesh_lod;
+typedef struct taa_scenemesh_quantization_s taa_scenemesh_quantization;
 typedef struct taa_scenemesh_stream_s taa_scenemesh_stream;
 typedef struct taa_scenemesh_s taa_scenemesh;
 
@@ -92,6 +147,15 @@ struct taa_scenemesh_vertformat_s
      * @brief vertex stream for the element
      */
     uint32_t stream;
+    /**
+     * @brief optional quantization of the element
+     * @details valuetype must be a normalized type when this is not NONE
+     */
+    taa_scenemesh_quantize quantize;
+    /**
+     * @brief how often the element is read, see taa_scenemesh_plan_format
+     */
+    taa_scenemesh_access access;
 };
 
 struct taa_scenemesh_face_s
@@ -113,12 +177,111 @@ struct taa_scenemesh_skinjoint_s
     taa_mat44 invbindmatrix;
 };
 
+/**
+ * @brief axis aligned box and bounding sphere of a set of positions
+ */
+struct taa_scenemesh_bounds_s
+{
+    float min[3];
+    float max[3];
+    float center[3];
+    float radius;
+};
+
 struct taa_scenemesh_binding_s
 {
     char name[taa_SCENEMESH_NAMESIZE];
     int32_t materialid;
     uint32_t firstface;
     uint32_t numfaces;
+    /**
+     * @brief set by taa_scenemesh_calc_bounds
+     */
+    taa_scenemesh_bounds bounds;
+    /**
+     * @brief joint palette of the binding, set by taa_scenemesh_split_palettes
+     * @details when numpalettejoints is not 0, the blend indices of the
+     *          binding's vertices are offsets into the palette, which holds
+     *          skin joint indices starting at
+     *          mesh->palettejoints[firstpalettejoint]. Otherwise the blend
+     *          indices reference mesh->joints directly.
+     */
+    uint32_t firstpalettejoint;
+    uint32_t numpalettejoints;
+};
+
+/**
+ * @brief the simplified triangles of a single binding at one level of detail
+ * @details the indices reference the vertices of the mesh, and level 0 is
+ *          the unsimplified mesh, which is not stored as a lod.
+ */
+struct taa_scenemesh_lod_s
+{
+    uint32_t level;
+    uint32_t binding;
+    /**
+     * @brief offset into the lod index array of the mesh
+     */
+    uint32_t firstindex;
+    /**
+     * @brief 3 indices per triangle
+     */
+    uint32_t numindices;
+    /**
+     * @brief approximate distance the level deviates from the original
+     */
+    float error;
+};
+
+/**
+ * @brief a cluster of triangles from a single binding
+ * @details the cluster may be culled when the bounding sphere is outside the
+ *          view, or when all of its triangles face away from the camera:
+ *          dot(normalize(coneapex - camerapos), coneaxis) >= conecutoff
+ */
+struct taa_scenemesh_meshlet_s
+{
+    uint32_t binding;
+    /**
+     * @brief offset into the meshlet vertex array of the mesh
+     */
+    uint32_t firstvertex;
+    uint32_t numvertices;
+    /**
+     * @brief offset into the meshlet index array of the mesh
+     */
+    uint32_t firstindex;
+    uint32_t numtriangles;
+    float center[3];
+    float radius;
+    float coneapex[3];
+    float coneaxis[3];
+    /**
+     * @brief sine of the cone angle, 1 if the cluster can not be culled
+     */
+    float conecutoff;
+};
+
+/**
+ * @brief records how a vertex stream was quantized and how to decode it
+ */
+struct taa_scenemesh_quantization_s
+{
+    taa_scenemesh_usage usage;
+    uint32_t set;
+    taa_scenemesh_quantize quantize;
+    /**
+     * @brief per component scale applied to the normalized values
+     */
+    float scale[4];
+    /**
+     * @brief per component bias added after scaling
+     */
+    float bias[4];
+    /**
+     * @brief largest absolute error of any decoded component
+     */
+    float maxerror;
 };
 
 struct taa_scenemesh_stream_s
@@ -153,6 +316,21 @@ struct taa_scenemesh_stream_s
      * @brief data buffer
      */
     uint8_t* buffer;
+    /**
+     * @brief number of bytes allocated for the buffer
+     * @details grows geometrically as vertices are added. see
+     *          taa_scenemesh_reserve_vertices and taa_scenemesh_shrink_to_fit.
+     */
+    size_t capacity;
+    /**
+     * @brief optional open addressed hash table of vertex indices
+     * @details NULL unless created with taa_scenemesh_create_vertexhash
+     */
+    uint32_t* vertexhash;
+    /**
+     * @brief number of slots in the vertex hash table, a power of two
+     */
+    uint32_t vertexhashsize;
 };
 
 struct taa_scenemesh_s
@@ -167,18 +345,100 @@ struct taa_scenemesh_s
      * @brief id of skeleton bound to skinning data
      */
     int32_t skeleton;
+    /**
+     * @brief number of bytes per value in the index buffer, 4 or 2
+     * @details the index buffer holds uint16_t values when this is 2. see
+     *          taa_scenemesh_narrow_indices.
+     */
+    uint32_t indexwidth;
+    /**
+     * @brief bounds of all the bindings, set by taa_scenemesh_calc_bounds
+     */
+    taa_scenemesh_bounds bounds;
 
     uint32_t numjoints;
     uint32_t numfaces;
     uint32_t numbindings;
     uint32_t numstreams;
     uint32_t numindices;
+    uint32_t numquantizations;
+    uint32_t nummeshlets;
+    uint32_t nummeshletvertices;
+    uint32_t nummeshletindices;
+    uint32_t numlods;
+    uint32_t numlodindices;
+    uint32_t numpalettejoints;
+    uint32_t numdepthindices;
 
     taa_scenemesh_skinjoint* joints;
     taa_scenemesh_face* faces;
     taa_scenemesh_binding* bindings;
     taa_scenemesh_stream* vertexstreams;
     uint32_t* indices;
+    taa_scenemesh_quantization* quantizations;
+    taa_scenemesh_meshlet* meshlets;
+    /**
+     * @brief mesh vertex indices referenced by each meshlet
+     */
+    uint32_t* meshletvertices;
+    /**
+     * @brief 3 indices per meshlet triangle, relative to its first vertex
+     */
+    uint8_t* meshletindices;
+    /**
+     * @brief lods sorted by level, then by binding
+     */
+    taa_scenemesh_lod* lods;
+    uint32_t* lodindices;
+    /**
+     * @brief skin joint indices of the joint palettes of the bindings
+     */
+    uint32_t* palettejoints;
+    /**
+     * @brief distinct positions of the vertices, for depth only passes
+     * @details empty unless made by taa_scenemesh_build_depth
+     */
+    taa_scenemesh_stream depthstream;
+    /**
+     * @brief indices into the depth stream, parallel to the index buffer
+     * @details the faces and bindings describe the depth geometry as well.
+     *          The values have the same width as the index buffer.
+     */
+    uint32_t* depthindices;
+};
+
+/**
+ * @brief list of memory chunks that grows without copying its contents
+ */
+struct taa_scenemesh_arena_s
+{
+    struct taa_scenemesh_chunk_s* first;
+    struct taa_scenemesh_chunk_s* last;
+    /**
+     * @brief number of bytes written to all the chunks
+     */
+    size_t size;
+};
+
+/**
+ * @brief gathers faces and vertices for a mesh in chunks
+ * @details faces, indices and the vertices of each stream are appended to
+ *          chunked arenas, and are only written to the mesh when the
+ *          builder is finalized. The faces and vertices of a mesh should
+ *          not be changed in any other way while it has a builder.
+ */
+struct taa_scenemesh_builder_s
+{
+    taa_scenemesh* mesh;
+    taa_scenemesh_arena faces;
+    taa_scenemesh_arena indices;
+    /**
+     * @brief vertices appended to each stream of the mesh
+     */
+    taa_scenemesh_arena* vertices;
+    uint32_t numstreams;
+    uint32_t numfaces;
+    uint32_t numindices;
 };
 
 //****************************************************************************
@@ -209,6 +469,7 @@ taa_SCENE_LINKAGE int taa_scenemesh_add_stream(
 
 /**
  * @return the index of the new vertex
+ * @details if the stream has a vertex hash, the new vertex is added to it
  */
 taa_SCENE_LINKAGE int taa_scenemesh_add_vertex(
     taa_scenemesh_stream* vs,
@@ -219,13 +480,135 @@ taa_SCENE_LINKAGE void taa_scenemesh_begin_binding(
     const char* name,
     int matid);
 
+/**
+ * @brief builds the position only depth stream and index buffer
+ * @details uses the position stream with set 0. The mesh must be processed
+ *          by taa_scenemesh_merge_indices, and this should be called after
+ *          any other pass that changes the vertices or indices, but before
+ *          taa_scenemesh_narrow_indices.
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_build_depth(
+    taa_scenemesh* mesh);
+
+/**
+ * @brief splits the triangles of each binding into meshlets
+ * @details any existing meshlets are replaced. Triangles are grouped
+ *          greedily by shared vertices, in the current triangle order, so
+ *          this should be called after the index order is final. The mesh
+ *          must be processed by taa_scenemesh_merge_indices and
+ *          taa_scenemesh_triangulate. Bounds are calculated from the
+ *          position stream with set 0, if there is one.
+ * @param maxvertices maximum vertices per meshlet, no more than 256
+ * @param maxtriangles maximum triangles per meshlet
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_build_meshlets(
+    taa_scenemesh* mesh,
+    uint32_t maxvertices,
+    uint32_t maxtriangles);
+
+/**
+ * @brief appends a face, as with taa_scenemesh_add_face
+ * @param indices mesh->indexsize indices for each vertex of the face
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_builder_add_face(
+    taa_scenemesh_builder* builder,
+    const uint32_t* indices,
+    uint32_t numvertices);
+
+/**
+ * @brief appends several faces whose indices are packed together
+ * @param facesizes number of vertices in each face
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_builder_add_faces(
+    taa_scenemesh_builder* builder,
+    const uint32_t* indices,
+    const uint32_t* facesizes,
+    uint32_t numfaces);
+
+/**
+ * @brief appends vertices to a stream of the mesh
+ * @param stream index of the stream in mesh->vertexstreams
+ * @param vertdata numverts vertices at the stride of the stream
+ * @return the index the first vertex will have in the stream
+ */
+taa_SCENE_LINKAGE uint32_t taa_scenemesh_builder_add_vertices(
+    taa_scenemesh_builder* builder,
+    uint32_t stream,
+    const void* vertdata,
+    uint32_t numverts);
+
+taa_SCENE_LINKAGE void taa_scenemesh_builder_begin_binding(
+    taa_scenemesh_builder* builder,
+    const char* name,
+    int matid);
+
+/**
+ * @brief starts building onto a mesh
+ * @details the streams of the mesh must be added before the builder is
+ *          created, and the mesh must outlive the builder.
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_builder_create(
+    taa_scenemesh* mesh,
+    taa_scenemesh_builder* builder_out);
+
+taa_SCENE_LINKAGE void taa_scenemesh_builder_destroy(
+    taa_scenemesh_builder* builder);
+
+taa_SCENE_LINKAGE void taa_scenemesh_builder_end_binding(
+    taa_scenemesh_builder* builder);
+
+/**
+ * @brief writes everything gathered by the builder into the mesh
+ * @details each buffer of the mesh is resized once, with vertex streams
+ *          sized exactly, and the builder is emptied so it may be used
+ *          again.
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_builder_finalize(
+    taa_scenemesh_builder* builder);
+
+/**
+ * @brief calculates the bounds of the mesh and of each binding
+ * @details the bounds cover the positions, from the position stream with
+ *          set 0, referenced by the faces of each binding. The bounds are
+ *          kept valid by taa_scenemesh_rotate_upaxis, but must be calculated
+ *          again after any other change to the positions.
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_calc_bounds(
+    taa_scenemesh* mesh);
+
+/**
+ * @brief calculates the skinning matrix of each joint in the mesh
+ * @details each matrix is the pose of the joint multiplied by its inverse
+ *          bind matrix. palette_out must hold mesh->numjoints matrices.
+ * @param pose world transform of each joint in the skeleton, indexed by
+ *        taa_scenemesh_skinjoint::animjoint. These may be calculated with
+ *        taa_scenenode_calc_transform for the node of each sceneskel joint.
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_calc_skinpalette(
+    const taa_scenemesh* mesh,
+    const taa_mat44* pose,
+    taa_mat44* palette_out);
+
 taa_SCENE_LINKAGE void taa_scenemesh_create(
     const char* name,
     taa_scenemesh* mesh_out);
 
+/**
+ * @brief builds a hash index of the vertex data in the stream
+ * @details once created, the hash is kept current by the functions that
+ *          modify the stream, and is used by taa_scenemesh_find_vertex.
+ *          vertices written directly into the buffer are not tracked
+ *          unless this function is called again to rebuild the hash.
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_create_vertexhash(
+    taa_scenemesh_stream* vs);
+
 taa_SCENE_LINKAGE void taa_scenemesh_destroy(
     taa_scenemesh* mesh);
 
+taa_SCENE_LINKAGE void taa_scenemesh_destroy_vertexhash(
+    taa_scenemesh_stream* vs);
+
 taa_SCENE_LINKAGE void taa_scenemesh_end_binding(
     taa_scenemesh* mesh);
 
@@ -233,6 +616,23 @@ taa_SCENE_LINKAGE int taa_scenemesh_find_binding(
     taa_scenemesh* mesh,
     const char* name);
 
+/**
+ * @brief finds a matching vertex, or appends the vertex if none exists
+ * @return the index of the matching or newly added vertex
+ */
+taa_SCENE_LINKAGE int taa_scenemesh_find_or_add_vertex(
+    taa_scenemesh_stream* vs,
+    const void* vertdata);
+
+/**
+ * @brief finds the decode parameters of a quantized stream
+ * @return the index of the quantization on success, or -1 if not quantized
+ */
+taa_SCENE_LINKAGE int taa_scenemesh_find_quantization(
+    const taa_scenemesh* mesh,
+    taa_scenemesh_usage usage,
+    uint32_t set);
+
 taa_SCENE_LINKAGE int taa_scenemesh_find_stream(
     taa_scenemesh* mesh,
     taa_scenemesh_usage usage,
@@ -240,6 +640,8 @@ taa_SCENE_LINKAGE int taa_scenemesh_find_stream(
 
 /**
  * @brief finds the index associated with the vertex data in the given stream
+ * @details uses the vertex hash if the stream has one, otherwise performs a
+ *          linear search of the stream.
  * @param vs the vertex stream to search
  * @param vertdata the source vertex data to match.
  * @return the matching vertex index on success, or -1 on failure.
@@ -252,6 +654,8 @@ taa_SCENE_LINKAGE int taa_scenemesh_find_vertex(
  * Formats the mesh according to the soecified vertex definitions
  * <p>Since the formatting process likely involves merging streams
  * together, this function will also merge indices.</p>
+ * <p>Elements with a quantize mode are converted with
+ * taa_scenemesh_quantize_stream instead of taa_scenemesh_format_stream.</p>
  */
 taa_SCENE_LINKAGE void taa_scenemesh_format(
     taa_scenemesh* mesh,
@@ -263,6 +667,31 @@ taa_SCENE_LINKAGE void taa_scenemesh_format_stream(
     taa_scenemesh_valuetype valuetype,
     unsigned int numcomponents);
 
+/**
+ * @brief calculates smooth vertex normals from the faces of the mesh
+ * @details replaces the normal stream with set 0. When the indices are not
+ *          merged, the normals get an index of their own. Otherwise vertices
+ *          with more than one normal are duplicated, which discards meshlets
+ *          and lods.
+ * @param creaseangle largest angle in radians between smoothed faces
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_generate_normals(
+    taa_scenemesh* mesh,
+    float creaseangle);
+
+/**
+ * @brief calculates tangent frames from the normals and texture coordinates
+ * @details replaces the tangent and binormal streams with set 0, following
+ *          MikkTSpace. Vertices with more than one frame are duplicated,
+ *          which discards meshlets and lods. The mesh must be processed by
+ *          taa_scenemesh_merge_indices and taa_scenemesh_triangulate, and
+ *          have position and normal streams with set 0.
+ * @param texcoordset set of the texture coordinate stream to follow
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_generate_tangents(
+    taa_scenemesh* mesh,
+    uint32_t texcoordset);
+
 /**
  * Merges vertex indices together so that one index exists per vertex
  * <p>If vertex streams have independent indices, this function will rearrange
@@ -281,14 +710,124 @@ taa_SCENE_LINKAGE int taa_scenemesh_merge_streams(
     const uint32_t* streamoffsets,
     uint32_t numstreams);
 
+/**
+ * @brief converts the index buffer to 16 bit values if possible
+ * @details if every index is less than 65536, the index buffer is packed in
+ *          place as uint16_t values, shrunk, and indexwidth is set to 2.
+ *          The depth indices, if any, are packed the same way. This should
+ *          be the last step of processing a mesh; functions that modify
+ *          the index buffer cannot be used on a narrowed mesh.
+ * @return 0 if the indices were narrowed, -1 if they do not fit in 16 bits
+ */
+taa_SCENE_LINKAGE int taa_scenemesh_narrow_indices(
+    taa_scenemesh* mesh);
+
+/**
+ * @brief reorders clusters of triangles to reduce overdraw
+ * @details the triangles of each binding are split into clusters along the
+ *          existing order, and the clusters are sorted so that those facing
+ *          away from the center of the mesh are drawn first. The ordering
+ *          is view independent and uses the position stream with set 0.
+ *          This should be called after taa_scenemesh_optimize_vertex_cache.
+ * @param threshold how much the vertex cache miss ratio may degrade in
+ *                  exchange for smaller clusters, i.e. 1.05 for 5%
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_optimize_overdraw(
+    taa_scenemesh* mesh,
+    float threshold);
+
+/**
+ * @brief reorders triangles to improve post transform vertex cache hits
+ * @details triangles are reordered within each binding using Tom Forsyth's
+ *          linear speed vertex cache optimization. The face ranges of the
+ *          bindings are unchanged. The mesh must already be processed by
+ *          taa_scenemesh_merge_indices and taa_scenemesh_triangulate.
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_optimize_vertex_cache(
+    taa_scenemesh* mesh);
+
+/**
+ * @brief reorders vertices to improve locality of vertex fetches
+ * @details the vertices of every stream are sorted by their first use in the
+ *          index buffer, and the indices are remapped to match. Unreferenced
+ *          vertices are moved to the end of the streams. Meshlet and lod
+ *          vertex indices are remapped as well. The mesh must have merged
+ *          indices, and this should be called after the index order is
+ *          final, i.e. after taa_scenemesh_optimize_vertex_cache.
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_optimize_vertex_fetch(
+    taa_scenemesh* mesh);
+
+/**
+ * @brief chooses the stream and offset of each vertex format element
+ * @details hot elements share the first stream, warm elements the next,
+ *          and each cold element gets a stream of its own. The result may
+ *          be passed to taa_scenemesh_format.
+ * @param alignment alignment in bytes of each element, no less than 4.
+ *        Elements with larger components are aligned to the component size.
+ * @return the number of streams in the layout
+ */
+taa_SCENE_LINKAGE int taa_scenemesh_plan_format(
+    taa_scenemesh_vertformat* vf,
+    int numvf,
+    uint32_t alignment);
+
+/**
+ * @brief limits and packs the skin influences of each vertex
+ * @details weights become UNORM8 values that add to 255, and indices become
+ *          UINT8, or UINT16 if more than 256 joints remain. Unused joints
+ *          are removed. This must be called before
+ *          taa_scenemesh_split_palettes and taa_scenemesh_merge_streams.
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_prune_influences(
+    taa_scenemesh* mesh,
+    uint32_t maxinfluences);
+
+/**
+ * @brief quantizes a vertex stream and records its decode parameters
+ * @details the stream must not already be quantized. OCTAHEDRAL requires 2
+ *          components, or 3 to keep the handedness. A depth stream built
+ *          from the stream is encoded the same way.
+ * @param valuetype one of the SNORM or UNORM value types
+ * @return the largest absolute error of any decoded component
+ */
+taa_SCENE_LINKAGE float taa_scenemesh_quantize_stream(
+    taa_scenemesh* mesh,
+    taa_scenemesh_stream* vs,
+    taa_scenemesh_quantize quantize,
+    taa_scenemesh_valuetype valuetype,
+    unsigned int numcomponents);
+
+/**
+ * @brief removes degenerate and duplicate triangles
+ * @details duplicates must repeat an earlier triangle of the same binding
+ *          in the same winding order, so double sided geometry is kept. The
+ *          mesh must be processed by taa_scenemesh_triangulate.
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_remove_degenerates(
+    taa_scenemesh* mesh);
+
 taa_SCENE_LINKAGE void taa_scenemesh_remove_stream(
     taa_scenemesh* mesh,
     taa_scenemesh_stream* vs);
 
+/**
+ * @brief allocates room for numverts vertices at the current stride
+ * @details the vertex count is not changed, but vertices up to numverts
+ *          may be added without reallocating the buffer.
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_reserve_vertices(
+    taa_scenemesh_stream* vs,
+    uint32_t numverts);
+
 taa_SCENE_LINKAGE void taa_scenemesh_resize_bindings(
     taa_scenemesh* mesh,
     uint32_t numbindings);
 
+taa_SCENE_LINKAGE void taa_scenemesh_resize_depthindices(
+    taa_scenemesh* mesh,
+    uint32_t numdepthindices);
+
 taa_SCENE_LINKAGE void taa_scenemesh_resize_faces(
     taa_scenemesh* mesh,
     uint32_t numfaces);
@@ -297,6 +836,25 @@ taa_SCENE_LINKAGE void taa_scenemesh_resize_indices(
     taa_scenemesh* mesh,
     uint32_t numindices);
 
+taa_SCENE_LINKAGE void taa_scenemesh_resize_lods(
+    taa_scenemesh* mesh,
+    uint32_t numlods,
+    uint32_t numlodindices);
+
+taa_SCENE_LINKAGE void taa_scenemesh_resize_meshlets(
+    taa_scenemesh* mesh,
+    uint32_t nummeshlets,
+    uint32_t nummeshletvertices,
+    uint32_t nummeshletindices);
+
+taa_SCENE_LINKAGE void taa_scenemesh_resize_palettejoints(
+    taa_scenemesh* mesh,
+    uint32_t numpalettejoints);
+
+taa_SCENE_LINKAGE void taa_scenemesh_resize_quantizations(
+    taa_scenemesh* mesh,
+    uint32_t numquantizations);
+
 taa_SCENE_LINKAGE void taa_scenemesh_resize_skinjoints(
     taa_scenemesh* mesh,
     uint32_t numjoints);
@@ -319,7 +877,88 @@ taa_SCENE_LINKAGE void taa_scenemesh_rotate_upaxis(
     taa_scenemesh* mesh,
     int32_t dir);
 
+/**
+ * @brief applies the up axis rotation to a range of vertices in a stream
+ * @details swaps the y and z components and negates one of them, the same
+ *          as taa_scenemesh_rotate_upaxis does for position, normal,
+ *          tangent and binormal streams. Quantization records and vertex
+ *          hashes are not updated. Ranges that do not overlap may be
+ *          rotated from different threads, to split up large streams.
+ * @param dir +1 for counter-clockwise rotation, -1 for clockwise
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_rotate_vertices(
+    taa_scenemesh_stream* vs,
+    int32_t dir,
+    uint32_t firstvertex,
+    uint32_t numvertices);
+
+/**
+ * @brief releases the unused capacity of every vertex stream
+ * @details the depth stream is included. Meant to be called once a mesh
+ *          is finished. The streams grow again as needed if vertices are
+ *          added later.
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_shrink_to_fit(
+    taa_scenemesh* mesh);
+
+/**
+ * @brief generates a chain of simplified index buffers for each binding
+ * @details levels reference the existing vertices, and any existing lods
+ *          are replaced. The mesh must be processed by
+ *          taa_scenemesh_merge_indices and taa_scenemesh_triangulate, and
+ *          have a position stream with set 0.
+ * @param ratios fraction of the original triangles to keep for each level,
+ *               in decreasing order
+ * @param maxerror largest deviation from the surface, in position units
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_simplify(
+    taa_scenemesh* mesh,
+    const float* ratios,
+    uint32_t numlevels,
+    float maxerror);
+
+/**
+ * @brief calculates skinned positions and normals for a range of vertices
+ * @details the mesh must be processed by taa_scenemesh_merge_indices, and
+ *          not by taa_scenemesh_split_palettes. Ranges that do not overlap
+ *          may be skinned from different threads.
+ * @param palette skinning matrices from taa_scenemesh_calc_skinpalette
+ * @param positions_out receives 3 floats for each vertex in the range
+ * @param normals_out receives 3 floats for each vertex, may be NULL
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_skin(
+    taa_scenemesh* mesh,
+    const taa_mat44* palette,
+    uint32_t firstvertex,
+    uint32_t numvertices,
+    float* positions_out,
+    float* normals_out);
+
+/**
+ * @brief splits bindings so that each uses a limited number of joints
+ * @details each binding is divided, in face order, into bindings with
+ *          their own joint palette, and the blend indices with set 0 become
+ *          palette offsets. Meshlets and lods are discarded. The mesh must
+ *          be processed by taa_scenemesh_merge_indices, and not by
+ *          taa_scenemesh_merge_streams.
+ * @param maxjoints palette size, no less than the joints used by any face
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_split_palettes(
+    taa_scenemesh* mesh,
+    uint32_t maxjoints);
+
 taa_SCENE_LINKAGE void taa_scenemesh_triangulate(
     taa_scenemesh* mesh);
 
+/**
+ * @brief collapses vertices that are nearly identical in every stream
+ * @details should be called before taa_scenemesh_merge_indices and any
+ *          quantization. Welding merged indices discards meshlets and lods.
+ * @param tolerances largest difference per component, indexed by usage up
+ *        to taa_SCENEMESH_USAGE_MERGED. 0 only welds exact matches.
+ */
+taa_SCENE_LINKAGE void taa_scenemesh_weld_vertices(
+    taa_scenemesh* mesh,
+    const float* tolerances);
+
 #endif // taa_SCENEMESH_H_
@@ -522,3 +522,16 @@ void taa_scene_resize_textures(
         scene->numtextures = numtextures;
     }
 }
+
+//****************************************************************************
+void taa_scene_shrink_to_fit(
+    taa_scene* scene)
+{
+    taa_scenemesh* meshitr = scene->meshes;
+    taa_scenemesh* meshend = meshitr + scene->nummeshes;
+    while(meshitr != meshend)
+    {
+        taa_scenemesh_shrink_to_fit(meshitr);
+        ++meshitr;
+    }
+}
@@ -19,6 +19,15 @@
     (((uint64_t) 'N') << 48) | \
     (((uint64_t) 'E') << 56) )
 
+// version 1 adds the index width of meshes
+// version 2 adds the quantization records of meshes
+// version 3 adds the meshlets of meshes
+// version 4 adds the lods of meshes
+// version 5 adds the bounds of meshes and bindings
+// version 6 adds the joint palettes of bindings
+// version 7 adds the depth streams and indices of meshes
+#define taa_SCENEFILE_VERSION 7
+
 //****************************************************************************
 static int32_t taa_scenefile_deserialize_animation(
     taa_filestream* fs,
@@ -63,6 +72,76 @@ static int32_t taa_scenefile_deserialize_animation(
     return err;
 }
 
+//****************************************************************************
+static int32_t taa_scenefile_deserialize_bounds(
+    taa_filestream* fs,
+    taa_scenemesh_bounds* bounds)
+{
+    int32_t err = 0;
+    err |= taa_filestream_read_f32n(fs, bounds->min, 3);
+    err |= taa_filestream_read_f32n(fs, bounds->max, 3);
+    err |= taa_filestream_read_f32n(fs, bounds->center, 3);
+    err |= taa_filestream_read_f32(fs, &bounds->radius);
+    return err;
+}
+
+//****************************************************************************
+static int32_t taa_scenefile_deserialize_buffer(
+    taa_filestream* fs,
+    taa_scenemesh_stream* vs)
+{
+    int32_t err = 0;
+    int32_t valuesize = 0;
+    int32_t stride;
+    uint32_t numvertices;
+    err |= taa_filestream_read_i8n(fs, vs->name, sizeof(vs->name));
+    err |= taa_filestream_read_i32(fs, &vs->usage);
+    err |= taa_filestream_read_i32(fs, &vs->set);
+    err |= taa_filestream_read_i32(fs, &vs->valuetype);
+    err |= taa_filestream_read_i32(fs, &vs->numcomponents);
+    err |= taa_filestream_read_i32(fs, &vs->indexmapping);
+    err |= taa_filestream_read_i32(fs, &stride);
+    err |= taa_filestream_read_i32(fs, &numvertices);
+    if(err == 0)
+    {
+        taa_scenemesh_resize_vertices(vs, stride, numvertices);
+        // an empty stream, such as an unused depth stream, may have no
+        // components and has no buffer
+        if(numvertices > 0)
+        {
+            valuesize = vs->stride / vs->numcomponents;
+            switch(valuesize)
+            {
+            case 2:
+                err |= taa_filestream_read_i16n(
+                    fs,
+                    vs->buffer,
+                    numvertices * vs->numcomponents);
+                break;
+            case 4:
+                err |= taa_filestream_read_i32n(
+                    fs,
+                    vs->buffer,
+                    numvertices * vs->numcomponents);
+                break;
+            case 8:
+                err |= taa_filestream_read_i64n(
+                    fs,
+                    vs->buffer,
+                    numvertices * vs->numcomponents);
+                break;
+            default:
+                err |= taa_filestream_read_i8n(
+                    fs,
+                    vs->buffer,
+                    numvertices * vs->stride);
+                break;
+            }
+        }
+    }
+    return err;
+}
+
 //****************************************************************************
 static int32_t taa_scenefile_deserialize_material(
     taa_filestream* fs,
@@ -85,14 +164,33 @@ static int32_t taa_scenefile_deserialize_mesh(
     uint32_t numbindings;
     uint32_t numstreams;
     uint32_t numindices;
+    uint32_t numquantizations;
+    uint32_t nummeshlets;
+    uint32_t nummeshletvertices;
+    uint32_t nummeshletindices;
+    uint32_t numlods;
+    uint32_t numlodindices;
+    uint32_t numpalettejoints;
+    uint32_t numdepthindices;
+    uint32_t indexwidth;
     err |= taa_filestream_read_i8n(fs, mesh->name, sizeof(mesh->name));
     err |= taa_filestream_read_i32(fs, &mesh->indexsize);
     err |= taa_filestream_read_i32(fs, &mesh->skeleton);
+    err |= taa_filestream_read_i32(fs, &indexwidth);
+    err |= taa_scenefile_deserialize_bounds(fs, &mesh->bounds);
     err |= taa_filestream_read_i32(fs, &numjoints);
     err |= taa_filestream_read_i32(fs, &numfaces);
     err |= taa_filestream_read_i32(fs, &numbindings);
     err |= taa_filestream_read_i32(fs, &numstreams);
     err |= taa_filestream_read_i32(fs, &numindices);
+    err |= taa_filestream_read_i32(fs, &numquantizations);
+    err |= taa_filestream_read_i32(fs, &nummeshlets);
+    err |= taa_filestream_read_i32(fs, &nummeshletvertices);
+    err |= taa_filestream_read_i32(fs, &nummeshletindices);
+    err |= taa_filestream_read_i32(fs, &numlods);
+    err |= taa_filestream_read_i32(fs, &numlodindices);
+    err |= taa_filestream_read_i32(fs, &numpalettejoints);
+    err |= taa_filestream_read_i32(fs, &numdepthindices);
     if(err == 0)
     {
         taa_scenemesh_skinjoint* jointitr;
@@ -138,6 +236,9 @@ static int32_t taa_scenefile_deserialize_mesh(
             err |= taa_filestream_read_i32(fs, &binditr->materialid);
             err |= taa_filestream_read_i32(fs, &binditr->firstface);
             err |= taa_filestream_read_i32(fs, &binditr->numfaces);
+            err |= taa_scenefile_deserialize_bounds(fs, &binditr->bounds);
+            err |= taa_filestream_read_i32(fs, &binditr->firstpalettejoint);
+            err |= taa_filestream_read_i32(fs, &binditr->numpalettejoints);
             ++binditr;
         }
     }
@@ -150,53 +251,131 @@ static int32_t taa_scenefile_deserialize_mesh(
         vsend = vsitr + mesh->numstreams;
         while(vsitr != vsend && err == 0)
         {
-            int32_t valuesize;
-            int32_t stride;
-            uint32_t numvertices;
-            err|=taa_filestream_read_i8n(fs, vsitr->name,sizeof(vsitr->name));
-            err|=taa_filestream_read_i32(fs, &vsitr->usage);
-            err|=taa_filestream_read_i32(fs, &vsitr->set);
-            err|=taa_filestream_read_i32(fs, &vsitr->valuetype);
-            err|=taa_filestream_read_i32(fs, &vsitr->numcomponents);
-            err|=taa_filestream_read_i32(fs, &vsitr->indexmapping);
-            err|=taa_filestream_read_i32(fs, &stride);
-            err|=taa_filestream_read_i32(fs, &numvertices);
-            taa_scenemesh_resize_vertices(vsitr, stride, numvertices);
-            valuesize = vsitr->stride / vsitr->numcomponents;
-            switch(valuesize)
-            {
-            case 2:
-                err |= taa_filestream_read_i16n(
-                    fs,
-                    vsitr->buffer,
-                    numvertices * vsitr->numcomponents);
-                break;
-            case 4:
-                err |= taa_filestream_read_i32n(
-                    fs,
-                    vsitr->buffer,
-                    numvertices * vsitr->numcomponents);
-                break;
-            case 8:
-                err |= taa_filestream_read_i64n(
-                    fs,
-                    vsitr->buffer,
-                    numvertices * vsitr->numcomponents);
-                break;
-            default:
-                err |= taa_filestream_read_i8n(
-                    fs,
-                    vsitr->buffer,
-                    numvertices * vsitr->stride);
-                break;
-            }
+            err |= taa_scenefile_deserialize_buffer(fs, vsitr);
             ++vsitr;
         }
     }
     if(err == 0)
     {
         taa_scenemesh_resize_indices(mesh, numindices);
-        err |= taa_filestream_read_i32n(fs, mesh->indices, numindices);
+        switch(indexwidth)
+        {
+        case 2:
+            err |= taa_filestream_read_i16n(fs, mesh->indices, numindices);
+            break;
+        case 4:
+            err |= taa_filestream_read_i32n(fs, mesh->indices, numindices);
+            break;
+        default:
+            err = -1;
+            break;
+        }
+    }
+    if(err == 0)
+    {
+        taa_scenemesh_quantization* qitr;
+        taa_scenemesh_quantization* qend;
+        taa_scenemesh_resize_quantizations(mesh, numquantizations);
+        qitr = mesh->quantizations;
+        qend = qitr + numquantizations;
+        while(qitr != qend && err == 0)
+        {
+            err |= taa_filestream_read_i32(fs, &qitr->usage);
+            err |= taa_filestream_read_i32(fs, &qitr->set);
+            err |= taa_filestream_read_i32(fs, &qitr->quantize);
+            err |= taa_filestream_read_f32n(fs, qitr->scale, 4);
+            err |= taa_filestream_read_f32n(fs, qitr->bias, 4);
+            err |= taa_filestream_read_f32(fs, &qitr->maxerror);
+            ++qitr;
+        }
+    }
+    if(err == 0)
+    {
+        taa_scenemesh_meshlet* mlitr;
+        taa_scenemesh_meshlet* mlend;
+        taa_scenemesh_resize_meshlets(
+            mesh,
+            nummeshlets,
+            nummeshletvertices,
+            nummeshletindices);
+        mlitr = mesh->meshlets;
+        mlend = mlitr + nummeshlets;
+        while(mlitr != mlend && err == 0)
+        {
+            err |= taa_filestream_read_i32(fs, &mlitr->binding);
+            err |= taa_filestream_read_i32(fs, &mlitr->firstvertex);
+            err |= taa_filestream_read_i32(fs, &mlitr->numvertices);
+            err |= taa_filestream_read_i32(fs, &mlitr->firstindex);
+            err |= taa_filestream_read_i32(fs, &mlitr->numtriangles);
+            err |= taa_filestream_read_f32n(fs, mlitr->center, 3);
+            err |= taa_filestream_read_f32(fs, &mlitr->radius);
+            err |= taa_filestream_read_f32n(fs, mlitr->coneapex, 3);
+            err |= taa_filestream_read_f32n(fs, mlitr->coneaxis, 3);
+            err |= taa_filestream_read_f32(fs, &mlitr->conecutoff);
+            ++mlitr;
+        }
+        err |= taa_filestream_read_i32n(
+            fs,
+            mesh->meshletvertices,
+            nummeshletvertices);
+        err |= taa_filestream_read_i8n(
+            fs,
+            mesh->meshletindices,
+            nummeshletindices);
+    }
+    if(err == 0)
+    {
+        taa_scenemesh_lod* loditr;
+        taa_scenemesh_lod* lodend;
+        taa_scenemesh_resize_lods(mesh, numlods, numlodindices);
+        loditr = mesh->lods;
+        lodend = loditr + numlods;
+        while(loditr != lodend && err == 0)
+        {
+            err |= taa_filestream_read_i32(fs, &loditr->level);
+            err |= taa_filestream_read_i32(fs, &loditr->binding);
+            err |= taa_filestream_read_i32(fs, &loditr->firstindex);
+            err |= taa_filestream_read_i32(fs, &loditr->numindices);
+            err |= taa_filestream_read_f32(fs, &loditr->error);
+            ++loditr;
+        }
+        err |= taa_filestream_read_i32n(fs, mesh->lodindices, numlodindices);
+    }
+    if(err == 0)
+    {
+        taa_scenemesh_resize_palettejoints(mesh, numpalettejoints);
+        err |= taa_filestream_read_i32n(
+            fs,
+            mesh->palettejoints,
+            numpalettejoints);
+    }
+    if(err == 0)
+    {
+        err |= taa_scenefile_deserialize_buffer(fs, &mesh->depthstream);
+    }
+    if(err == 0)
+    {
+        taa_scenemesh_resize_depthindices(mesh, numdepthindices);
+        switch(indexwidth)
+        {
+        case 2:
+            err |= taa_filestream_read_i16n(
+                fs,
+                mesh->depthindices,
+                numdepthindices);
+            break;
+        case 4:
+            err |= taa_filestream_read_i32n(
+                fs,
+                mesh->depthindices,
+                numdepthindices);
+            break;
+        default:
+            err = -1;
+            break;
+        }
+        // set last, since index buffers cannot be resized once narrowed
+        mesh->indexwidth = indexwidth;
     }
     return err;
 }
@@ -326,6 +505,66 @@ static void taa_scenefile_serialize_animation(
     }
 }
 
+//****************************************************************************
+static void taa_scenefile_serialize_bounds(
+    const taa_scenemesh_bounds* bounds,
+    taa_filestream* fs)
+{
+    taa_filestream_write_f32n(fs, bounds->min, 3);
+    taa_filestream_write_f32n(fs, bounds->max, 3);
+    taa_filestream_write_f32n(fs, bounds->center, 3);
+    taa_filestream_write_f32(fs, bounds->radius);
+}
+
+//****************************************************************************
+static void taa_scenefile_serialize_buffer(
+    const taa_scenemesh_stream* vs,
+    taa_filestream* fs)
+{
+    int32_t valuesize = 0;
+    taa_filestream_write_i8n(fs, vs->name, sizeof(vs->name));
+    taa_filestream_write_i32(fs, vs->usage);
+    taa_filestream_write_i32(fs, vs->set);
+    taa_filestream_write_i32(fs, vs->valuetype);
+    taa_filestream_write_i32(fs, vs->numcomponents);
+    taa_filestream_write_i32(fs, vs->indexmapping);
+    taa_filestream_write_i32(fs, vs->stride);
+    taa_filestream_write_i32(fs, vs->numvertices);
+    // an empty stream, such as an unused depth stream, may have no
+    // components and has no buffer
+    if(vs->numvertices > 0)
+    {
+        valuesize = vs->stride / vs->numcomponents;
+        switch(valuesize)
+        {
+        case 2:
+            taa_filestream_write_i16n(
+                fs,
+                vs->buffer,
+                vs->numvertices * vs->numcomponents);
+            break;
+        case 4:
+            taa_filestream_write_i32n(
+                fs,
+                vs->buffer,
+                vs->numvertices * vs->numcomponents);
+            break;
+        case 8:
+            taa_filestream_write_i64n(
+                fs,
+                vs->buffer,
+                vs->numvertices * vs->numcomponents);
+            break;
+        default:
+            taa_filestream_write_i8n(
+                fs,
+                vs->buffer,
+                vs->numvertices * vs->stride);
+            break;
+        }
+    }
+}
+
 //****************************************************************************
 static void taa_scenefile_serialize_material(
     const taa_scenematerial* mat,
@@ -348,14 +587,30 @@ static void taa_scenefile_serialize_mesh(
     const taa_scenemesh_binding* bindend = binditr + mesh->numbindings;
     const taa_scenemesh_stream* vsitr = mesh->vertexstreams;
     const taa_scenemesh_stream* vsend = vsitr + mesh->numstreams;
+    const taa_scenemesh_quantization* qitr = mesh->quantizations;
+    const taa_scenemesh_quantization* qend = qitr + mesh->numquantizations;
+    const taa_scenemesh_meshlet* mlitr = mesh->meshlets;
+    const taa_scenemesh_meshlet* mlend = mlitr + mesh->nummeshlets;
+    const taa_scenemesh_lod* loditr = mesh->lods;
+    const taa_scenemesh_lod* lodend = loditr + mesh->numlods;
     taa_filestream_write_i8n(fs, mesh->name, sizeof(mesh->name));
     taa_filestream_write_i32(fs, mesh->indexsize);
     taa_filestream_write_i32(fs, mesh->skeleton);
+    taa_filestream_write_i32(fs, mesh->indexwidth);
+    taa_scenefile_serialize_bounds(&mesh->bounds, fs);
     taa_filestream_write_i32(fs, mesh->numjoints);
     taa_filestream_write_i32(fs, mesh->numfaces);
     taa_filestream_write_i32(fs, mesh->numbindings);
     taa_filestream_write_i32(fs, mesh->numstreams);
     taa_filestream_write_i32(fs, mesh->numindices);
+    taa_filestream_write_i32(fs, mesh->numquantizations);
+    taa_filestream_write_i32(fs, mesh->nummeshlets);
+    taa_filestream_write_i32(fs, mesh->nummeshletvertices);
+    taa_filestream_write_i32(fs, mesh->nummeshletindices);
+    taa_filestream_write_i32(fs, mesh->numlods);
+    taa_filestream_write_i32(fs, mesh->numlodindices);
+    taa_filestream_write_i32(fs, mesh->numpalettejoints);
+    taa_filestream_write_i32(fs, mesh->numdepthindices);
     while(jointitr != jointend)
     {
         taa_filestream_write_i32(fs, jointitr->animjoint);
@@ -375,49 +630,85 @@ static void taa_scenefile_serialize_mesh(
         taa_filestream_write_i32(fs, binditr->materialid);
         taa_filestream_write_i32(fs, binditr->firstface);
         taa_filestream_write_i32(fs, binditr->numfaces);
+        taa_scenefile_serialize_bounds(&binditr->bounds, fs);
+        taa_filestream_write_i32(fs, binditr->firstpalettejoint);
+        taa_filestream_write_i32(fs, binditr->numpalettejoints);
         ++binditr;
     }
     while(vsitr != vsend)
     {
-        int32_t valuesize = vsitr->stride / vsitr->numcomponents;
-        taa_filestream_write_i8n(fs, vsitr->name,sizeof(vsitr->name));
-        taa_filestream_write_i32(fs, vsitr->usage);
-        taa_filestream_write_i32(fs, vsitr->set);
-        taa_filestream_write_i32(fs, vsitr->valuetype);
-        taa_filestream_write_i32(fs, vsitr->numcomponents);
-        taa_filestream_write_i32(fs, vsitr->indexmapping);
-        taa_filestream_write_i32(fs, vsitr->stride);
-        taa_filestream_write_i32(fs, vsitr->numvertices);
-        switch(valuesize)
-        {
-        case 2:
-            taa_filestream_write_i16n(
-                fs,
-                vsitr->buffer,
-                vsitr->numvertices * vsitr->numcomponents);
-            break;
-        case 4:
-            taa_filestream_write_i32n(
-                fs,
-                vsitr->buffer,
-                vsitr->numvertices * vsitr->numcomponents);
-            break;
-        case 8:
-            taa_filestream_write_i64n(
-                fs,
-                vsitr->buffer,
-                vsitr->numvertices * vsitr->numcomponents);
-            break;
-        default:
-            taa_filestream_write_i8n(
-                fs,
-                vsitr->buffer,
-                vsitr->numvertices * vsitr->stride);
-            break;
-        }
+        taa_scenefile_serialize_buffer(vsitr, fs);
         ++vsitr;
     }
-    taa_filestream_write_i32n(fs, mesh->indices, mesh->numindices);
+    if(mesh->indexwidth == sizeof(uint16_t))
+    {
+        taa_filestream_write_i16n(fs, mesh->indices, mesh->numindices);
+    }
+    else
+    {
+        taa_filestream_write_i32n(fs, mesh->indices, mesh->numindices);
+    }
+    while(qitr != qend)
+    {
+        taa_filestream_write_i32(fs, qitr->usage);
+        taa_filestream_write_i32(fs, qitr->set);
+        taa_filestream_write_i32(fs, qitr->quantize);
+        taa_filestream_write_f32n(fs, qitr->scale, 4);
+        taa_filestream_write_f32n(fs, qitr->bias, 4);
+        taa_filestream_write_f32(fs, qitr->maxerror);
+        ++qitr;
+    }
+    while(mlitr != mlend)
+    {
+        taa_filestream_write_i32(fs, mlitr->binding);
+        taa_filestream_write_i32(fs, mlitr->firstvertex);
+        taa_filestream_write_i32(fs, mlitr->numvertices);
+        taa_filestream_write_i32(fs, mlitr->firstindex);
+        taa_filestream_write_i32(fs, mlitr->numtriangles);
+        taa_filestream_write_f32n(fs, mlitr->center, 3);
+        taa_filestream_write_f32(fs, mlitr->radius);
+        taa_filestream_write_f32n(fs, mlitr->coneapex, 3);
+        taa_filestream_write_f32n(fs, mlitr->coneaxis, 3);
+        taa_filestream_write_f32(fs, mlitr->conecutoff);
+        ++mlitr;
+    }
+    taa_filestream_write_i32n(
+        fs,
+        mesh->meshletvertices,
+        mesh->nummeshletvertices);
+    taa_filestream_write_i8n(
+        fs,
+        mesh->meshletindices,
+        mesh->nummeshletindices);
+    while(loditr != lodend)
+    {
+        taa_filestream_write_i32(fs, loditr->level);
+        taa_filestream_write_i32(fs, loditr->binding);
+        taa_filestream_write_i32(fs, loditr->firstindex);
+        taa_filestream_write_i32(fs, loditr->numindices);
+        taa_filestream_write_f32(fs, loditr->error);
+        ++loditr;
+    }
+    taa_filestream_write_i32n(fs, mesh->lodindices, mesh->numlodindices);
+    taa_filestream_write_i32n(
+        fs,
+        mesh->palettejoints,
+        mesh->numpalettejoints);
+    taa_scenefile_serialize_buffer(&mesh->depthstream, fs);
+    if(mesh->indexwidth == sizeof(uint16_t))
+    {
+        taa_filestream_write_i16n(
+            fs,
+            mesh->depthindices,
+            mesh->numdepthindices);
+    }
+    else
+    {
+        taa_filestream_write_i32n(
+            fs,
+            mesh->depthindices,
+            mesh->numdepthindices);
+    }
 }
 
 //****************************************************************************
@@ -502,7 +793,7 @@ int32_t taa_scenefile_deserialize(
         err = taa_filestream_read_i32(fs, &version);
         if(err == 0)
         {
-            err = (version == 0) ? 0 : -1;
+            err = (version == taa_SCENEFILE_VERSION) ? 0 : -1;
         }
     }
     if(err == 0)
@@ -616,7 +907,7 @@ void taa_scenefile_serialize(
     // write magic number
     taa_filestream_write_i64(fs, taa_SCENEFILE_MAGIC);
     // write version number
-    taa_filestream_write_i32(fs, 0);
+    taa_filestream_write_i32(fs, taa_SCENEFILE_VERSION);
     // write up axis
     taa_filestream_write_i32(fs, scene->upaxis);
     // write counts of items
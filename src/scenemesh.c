@@ -6,9 +6,113 @@
  ****************************************************************************/
 #include <taa/scenemesh.h>
 #include <assert.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define taa_SCENEMESH_SSE
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define taa_SCENEMESH_SSE2
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#define taa_SCENEMESH_AVX
+#endif
+
+enum
+{
+    /**
+     * @brief size of the simulated post transform vertex cache
+     */
+    taa_SCENEMESH_VCACHE_SIZE = 32,
+    /**
+     * @brief valence above which vertex scores stop changing
+     */
+    taa_SCENEMESH_VCACHE_MAXVALENCE = 64,
+    /**
+     * @brief smallest number of bytes allocated for a builder chunk
+     */
+    taa_SCENEMESH_CHUNKSIZE = 64 * 1024
+};
+
+typedef struct taa_scenemesh_chunk_s taa_scenemesh_chunk;
+typedef struct taa_scenemesh_collapse_s taa_scenemesh_collapse;
+typedef struct taa_scenemesh_formatkernel_s taa_scenemesh_formatkernel;
+typedef struct taa_scenemesh_overdrawkey_s taa_scenemesh_overdrawkey;
+typedef struct taa_scenemesh_quadric_s taa_scenemesh_quadric;
+
+/**
+ * @brief block of memory in a builder arena
+ * @details the data follows the header in the same allocation
+ */
+struct taa_scenemesh_chunk_s
+{
+    taa_scenemesh_chunk* next;
+    size_t size;
+    size_t capacity;
+};
+
+/**
+ * @brief candidate edge collapse for mesh simplification
+ */
+struct taa_scenemesh_collapse_s
+{
+    float cost;
+    uint32_t from;
+    uint32_t to;
+};
+
+/**
+ * @brief converts packed vertices of one format to another in a single pass
+ * @param numcomponents number of components in each destination vertex
+ */
+typedef void (*taa_scenemesh_formatfunc)(
+    const void* src,
+    void* dst,
+    uint32_t numvertices,
+    uint32_t numcomponents);
+
+/**
+ * @brief specialized conversion used by taa_scenemesh_format_stream
+ */
+struct taa_scenemesh_formatkernel_s
+{
+    taa_scenemesh_valuetype srctype;
+    uint32_t srccomponents;
+    taa_scenemesh_valuetype dsttype;
+    uint32_t dstcomponents;
+    taa_scenemesh_formatfunc func;
+};
+
+/**
+ * @brief sort key for a triangle cluster in the overdraw optimizer
+ */
+struct taa_scenemesh_overdrawkey_s
+{
+    float key;
+    uint32_t cluster;
+};
+
+/**
+ * @brief weighted sum of squared plane distances
+ * @details the symmetric 4x4 matrix of the planes is stored as its upper
+ *          triangle, along with the total weight of the planes
+ */
+struct taa_scenemesh_quadric_s
+{
+    double a2, b2, c2, d2;
+    double ab, ac, ad;
+    double bc, bd;
+    double cd;
+    double w;
+};
+
 // converts source vertex value type to new type in a loop
 #define taa_FORMAT_LOOP(srct, dstt, src, itr, end, srcinc, dstinc) \
     while(itr < end) \
@@ -18,7 +122,8 @@
         src += srcinc; \
     }
 
-// converts new value type enum to C type during vertex format conversion
+// converts new value type enum to C type during vertex format conversion.
+// normalized and half float types use taa_scenemesh_format_values instead.
 #define taa_FORMAT_NEWT(srct,dstenum,src,itr,end,srcinc,dstinc) \
     switch(dstenum) \
     { \
@@ -47,6 +152,11 @@
         taa_FORMAT_LOOP(srct,uint32_t,src,itr,end,srcinc,dstinc) \
         break; \
     case taa_SCENEMESH_VALUE_MERGED: \
+    case taa_SCENEMESH_VALUE_FLOAT16: \
+    case taa_SCENEMESH_VALUE_SNORM8: \
+    case taa_SCENEMESH_VALUE_SNORM16: \
+    case taa_SCENEMESH_VALUE_UNORM8: \
+    case taa_SCENEMESH_VALUE_UNORM16: \
         assert(0); \
         break; \
     }
@@ -80,6 +190,11 @@
         taa_FORMAT_NEWT(uint32_t,dstenum,src,itr,end,srcinc,dstinc) \
         break; \
     case taa_SCENEMESH_VALUE_MERGED: \
+    case taa_SCENEMESH_VALUE_FLOAT16: \
+    case taa_SCENEMESH_VALUE_SNORM8: \
+    case taa_SCENEMESH_VALUE_SNORM16: \
+    case taa_SCENEMESH_VALUE_UNORM8: \
+    case taa_SCENEMESH_VALUE_UNORM16: \
         assert(0); \
         break; \
     }
@@ -87,6 +202,27 @@
 #define taa_FORMAT(srcEnum,dstenum,src,itr,end,srcinc,dstinc) \
     taa_FORMAT_SRCT(srcEnum, dstenum, src, itr, end, srcinc, dstinc)
 
+//****************************************************************************
+static void taa_scenemesh_add_quadric(
+    taa_scenemesh_quadric* q,
+    const float* n,
+    float d,
+    float w)
+{
+    // accumulates the squared distance to the plane dot(n, p) + d = 0
+    q->a2 += w * n[0]*n[0];
+    q->b2 += w * n[1]*n[1];
+    q->c2 += w * n[2]*n[2];
+    q->d2 += w * d*d;
+    q->ab += w * n[0]*n[1];
+    q->ac += w * n[0]*n[2];
+    q->ad += w * n[0]*d;
+    q->bc += w * n[1]*n[2];
+    q->bd += w * n[1]*d;
+    q->cd += w * n[2]*d;
+    q->w += w;
+}
+
 //****************************************************************************
 static void* taa_scenemesh_aligned_realloc(
     void* ptr,
@@ -97,12 +233,163 @@ static void* taa_scenemesh_aligned_realloc(
     void* newptr = taa_memalign(align, newsize);
     if(ptr != NULL)
     {
-        memcpy(newptr, ptr, oldsize);
+        memcpy(newptr, ptr, (oldsize < newsize) ? oldsize : newsize);
         taa_memalign_free(ptr);
     }
     return newptr;
 }
 
+//****************************************************************************
+static void* taa_scenemesh_alloc_arena(
+    taa_scenemesh_arena* arena,
+    size_t size)
+{
+    // returns contiguous space for size bytes at the end of the arena,
+    // starting a new chunk if the last one is full
+    taa_scenemesh_chunk* chunk = arena->last;
+    uint8_t* data;
+    if(chunk == NULL || chunk->size + size > chunk->capacity)
+    {
+        size_t cap = taa_SCENEMESH_CHUNKSIZE;
+        cap = (size > cap) ? size : cap;
+        chunk = (taa_scenemesh_chunk*) malloc(sizeof(*chunk) + cap);
+        chunk->next = NULL;
+        chunk->size = 0;
+        chunk->capacity = cap;
+        if(arena->last != NULL)
+        {
+            arena->last->next = chunk;
+        }
+        else
+        {
+            arena->first = chunk;
+        }
+        arena->last = chunk;
+    }
+    data = ((uint8_t*) (chunk + 1)) + chunk->size;
+    chunk->size += size;
+    arena->size += size;
+    return data;
+}
+
+//****************************************************************************
+static void taa_scenemesh_calc_aabb(
+    const float* points,
+    uint32_t numpoints,
+    float* min_out,
+    float* max_out)
+{
+    // points are 16 byte aligned, with 4 floats per point
+    const float* pitr = points + 4;
+    const float* pend = points + numpoints*4;
+#ifdef taa_SCENEMESH_SSE
+    __m128 vmin = _mm_load_ps(points);
+    __m128 vmax = vmin;
+    float tmp[4];
+    while(pitr != pend)
+    {
+        __m128 p = _mm_load_ps(pitr);
+        vmin = _mm_min_ps(vmin, p);
+        vmax = _mm_max_ps(vmax, p);
+        pitr += 4;
+    }
+    _mm_storeu_ps(tmp, vmin);
+    memcpy(min_out, tmp, 3 * sizeof(*min_out));
+    _mm_storeu_ps(tmp, vmax);
+    memcpy(max_out, tmp, 3 * sizeof(*max_out));
+#else
+    memcpy(min_out, points, 3 * sizeof(*min_out));
+    memcpy(max_out, points, 3 * sizeof(*max_out));
+    while(pitr != pend)
+    {
+        uint32_t i;
+        for(i = 0; i < 3; ++i)
+        {
+            min_out[i] = (pitr[i] < min_out[i]) ? pitr[i] : min_out[i];
+            max_out[i] = (pitr[i] > max_out[i]) ? pitr[i] : max_out[i];
+        }
+        pitr += 4;
+    }
+#endif
+}
+
+//****************************************************************************
+static uint32_t taa_scenemesh_calc_numindexed(
+    const taa_scenemesh* mesh)
+{
+    // returns one past the largest vertex index referenced by the mesh
+    uint32_t numverts = 0;
+    const uint32_t* indexitr = mesh->indices;
+    const uint32_t* indexend = indexitr + mesh->numindices;
+    while(indexitr != indexend)
+    {
+        if(*indexitr >= numverts)
+        {
+            numverts = *indexitr + 1;
+        }
+        ++indexitr;
+    }
+    return numverts;
+}
+
+//****************************************************************************
+static void taa_scenemesh_calc_sphere_radii(
+    const float* points,
+    uint32_t numpoints,
+    const float* center0,
+    const float* center1,
+    float* radii_out)
+{
+    // finds the distance to the furthest point from two centers at once.
+    // points are 16 byte aligned, with 4 floats per point and w set to 0.
+    const float* pitr = points;
+    const float* pend = points + numpoints*4;
+#ifdef taa_SCENEMESH_SSE
+    __m128 c0 = _mm_set_ps(0.0f, center0[2], center0[1], center0[0]);
+    __m128 c1 = _mm_set_ps(0.0f, center1[2], center1[1], center1[0]);
+    __m128 m0 = _mm_setzero_ps();
+    __m128 m1 = _mm_setzero_ps();
+    while(pitr != pend)
+    {
+        __m128 p = _mm_load_ps(pitr);
+        __m128 d0 = _mm_sub_ps(p, c0);
+        __m128 d1 = _mm_sub_ps(p, c1);
+        d0 = _mm_mul_ps(d0, d0);
+        d1 = _mm_mul_ps(d1, d1);
+        d0 = _mm_add_ps(d0, _mm_shuffle_ps(d0, d0, _MM_SHUFFLE(2,3,0,1)));
+        d1 = _mm_add_ps(d1, _mm_shuffle_ps(d1, d1, _MM_SHUFFLE(2,3,0,1)));
+        d0 = _mm_add_ps(d0, _mm_shuffle_ps(d0, d0, _MM_SHUFFLE(1,0,3,2)));
+        d1 = _mm_add_ps(d1, _mm_shuffle_ps(d1, d1, _MM_SHUFFLE(1,0,3,2)));
+        m0 = _mm_max_ps(m0, d0);
+        m1 = _mm_max_ps(m1, d1);
+        pitr += 4;
+    }
+    _mm_store_ss(radii_out + 0, _mm_sqrt_ss(m0));
+    _mm_store_ss(radii_out + 1, _mm_sqrt_ss(m1));
+#else
+    float m0 = 0.0f;
+    float m1 = 0.0f;
+    while(pitr != pend)
+    {
+        float d[3];
+        float dist;
+        d[0] = pitr[0] - center0[0];
+        d[1] = pitr[1] - center0[1];
+        d[2] = pitr[2] - center0[2];
+        dist = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+        m0 = (dist > m0) ? dist : m0;
+        d[0] = pitr[0] - center1[0];
+        d[1] = pitr[1] - center1[1];
+        d[2] = pitr[2] - center1[2];
+        dist = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+        m1 = (dist > m1) ? dist : m1;
+        pitr += 4;
+    }
+    radii_out[0] = sqrtf(m0);
+    radii_out[1] = sqrtf(m1);
+#endif
+}
+
 //****************************************************************************
 static int taa_scenemesh_calc_stride(
     int valuetype,
@@ -120,1085 +407,6510 @@ static int taa_scenemesh_calc_stride(
     case taa_SCENEMESH_VALUE_UINT16:  compstride = sizeof(uint16_t); break;
     case taa_SCENEMESH_VALUE_UINT32:  compstride = sizeof(uint32_t); break;
     case taa_SCENEMESH_VALUE_MERGED:  assert(0); break;
+    case taa_SCENEMESH_VALUE_FLOAT16: compstride = sizeof(uint16_t); break;
+    case taa_SCENEMESH_VALUE_SNORM8:  compstride = sizeof(int8_t);   break;
+    case taa_SCENEMESH_VALUE_SNORM16: compstride = sizeof(int16_t);  break;
+    case taa_SCENEMESH_VALUE_UNORM8:  compstride = sizeof(uint8_t);  break;
+    case taa_SCENEMESH_VALUE_UNORM16: compstride = sizeof(uint16_t); break;
     }
     return compstride * numcomponents;
 }
 
 //****************************************************************************
-taa_scenemesh_face* taa_scenemesh_add_face(
-    taa_scenemesh* mesh,
-    const uint32_t* indices,
-    uint32_t numindices,
-    uint32_t numvertices)
+static void taa_scenemesh_calc_tri_key(
+    const uint32_t* tri,
+    uint32_t indexsize,
+    uint32_t* key_out)
 {
-    int32_t faceid = mesh->numfaces;
-    int32_t firstindex = mesh->numindices;
-    taa_scenemesh_face* newface;
-    uint32_t* newindices;
-    // resize face buffer
-    taa_scenemesh_resize_faces(mesh, faceid + 1);
-    newface = mesh->faces + faceid;
-    newface->firstindex = firstindex;
-    newface->numindices = numindices;
-    newface->numvertices = numvertices;
-    // resize index buffer and copy indices
-    taa_scenemesh_resize_indices(mesh, firstindex + numindices);
-    newindices = mesh->indices + firstindex;
-    memcpy(newindices, indices, sizeof(*newindices)*numindices);
-    return newface;
+    // rotates the corners of a triangle so the smallest comes first. Each
+    // rotation of a triangle gets the same key, but the opposite winding,
+    // as in a double sided triangle, does not.
+    uint32_t first = 0;
+    uint32_t k;
+    for(k = 1; k < 3; ++k)
+    {
+        const uint32_t* a = tri + k*indexsize;
+        const uint32_t* b = tri + first*indexsize;
+        uint32_t i = 0;
+        while(i < indexsize && a[i] == b[i])
+        {
+            ++i;
+        }
+        if(i < indexsize && a[i] < b[i])
+        {
+            first = k;
+        }
+    }
+    for(k = 0; k < 3; ++k)
+    {
+        memcpy(
+            key_out + k*indexsize,
+            tri + ((first + k) % 3)*indexsize,
+            indexsize * sizeof(*tri));
+    }
 }
 
 //****************************************************************************
-int taa_scenemesh_add_skinjoint(
-    taa_scenemesh* mesh,
-    uint32_t animjoint,
-    const taa_mat44* invbindmatrix)
+static void taa_scenemesh_calc_tri_normal(
+    const float* p0,
+    const float* p1,
+    const float* p2,
+    float* n_out)
 {
-    uint32_t jointid = mesh->numjoints;
-    taa_scenemesh_skinjoint* joint;
-    taa_scenemesh_resize_skinjoints(mesh, jointid + 1);
-    joint = mesh->joints + jointid;
-    joint->animjoint = animjoint;
-    joint->invbindmatrix = *invbindmatrix;
-    return jointid;
+    // unnormalized face normal, its length is twice the triangle area
+    float e0[3];
+    float e1[3];
+    e0[0] = p1[0] - p0[0];
+    e0[1] = p1[1] - p0[1];
+    e0[2] = p1[2] - p0[2];
+    e1[0] = p2[0] - p0[0];
+    e1[1] = p2[1] - p0[1];
+    e1[2] = p2[2] - p0[2];
+    n_out[0] = e0[1]*e1[2] - e0[2]*e1[1];
+    n_out[1] = e0[2]*e1[0] - e0[0]*e1[2];
+    n_out[2] = e0[0]*e1[1] - e0[1]*e1[0];
 }
 
 //****************************************************************************
-int taa_scenemesh_add_stream(
-    taa_scenemesh* mesh,
-    const char* name,
-    taa_scenemesh_usage usage,
-    int set,
-    taa_scenemesh_valuetype valuetype,
-    int numcomponents,
-    int stride,
-    int indexmapping,
-    uint32_t numvertices,
-    const void* srcbuffer)
+static int taa_scenemesh_check_collapse(
+    const uint32_t* tris,
+    const uint32_t* vertpos,
+    const float* points,
+    const uint32_t* postris,
+    const uint32_t* postrioffsets,
+    uint32_t from,
+    uint32_t to,
+    uint32_t* wedgemap)
 {
-    int32_t vsid = mesh->numstreams;
-    taa_scenemesh_stream* vs;
-    uint32_t bufsize;
-
-    // resize vertex stream array and grab pointer to new stream
-    taa_scenemesh_resize_streams(mesh, vsid + 1);
-    vs = mesh->vertexstreams + vsid;
+    // tests whether the position 'from' may be collapsed onto 'to'. every
+    // vertex at 'from' must share an edge with exactly one vertex at 'to',
+    // so attribute seams are preserved, and no remaining triangle may flip.
+    // on success wedgemap holds the target of each vertex at 'from'.
+    const uint32_t* titr;
+    const uint32_t* tend = postris + postrioffsets[from + 1];
+    const float* pto = points + to*3;
+    int result = 1;
+    for(titr = postris + postrioffsets[from]; titr != tend; ++titr)
+    {
+        const uint32_t* t = tris + (*titr)*3;
+        uint32_t wfrom = ~0U;
+        uint32_t wto = ~0U;
+        uint32_t k;
+        for(k = 0; k < 3; ++k)
+        {
+            if(vertpos[t[k]] == from) wfrom = t[k];
+            if(vertpos[t[k]] == to) wto = t[k];
+        }
+        if(wto != ~0U)
+        {
+            if(wedgemap[wfrom] == ~0U)
+            {
+                wedgemap[wfrom] = wto;
+            }
+            else if(wedgemap[wfrom] != wto)
+            {
+                result = 0;
+            }
+        }
+    }
+    for(titr = postris + postrioffsets[from]; titr != tend; ++titr)
+    {
+        const uint32_t* t = tris + (*titr)*3;
+        const float* p[3];
+        uint32_t numto = 0;
+        uint32_t k;
+        for(k = 0; k < 3; ++k)
+        {
+            uint32_t pos = vertpos[t[k]];
+            p[k] = points + pos*3;
+            if(pos == from && wedgemap[t[k]] == ~0U)
+            {
+                // this vertex has nothing to collapse onto
+                result = 0;
+            }
+            numto += (pos == to);
+        }
+        if(numto == 0 && result)
+        {
+            float n0[3];
+            float n1[3];
+            float len0;
+            float len1;
+            taa_scenemesh_calc_tri_normal(p[0], p[1], p[2], n0);
+            for(k = 0; k < 3; ++k)
+            {
+                p[k] = (vertpos[t[k]] == from) ? pto : p[k];
+            }
+            taa_scenemesh_calc_tri_normal(p[0], p[1], p[2], n1);
+            len0 = sqrtf(n0[0]*n0[0] + n0[1]*n0[1] + n0[2]*n0[2]);
+            len1 = sqrtf(n1[0]*n1[0] + n1[1]*n1[1] + n1[2]*n1[2]);
+            if(n0[0]*n1[0]+n0[1]*n1[1]+n0[2]*n1[2] < 0.25f*len0*len1)
+            {
+                result = 0;
+            }
+        }
+    }
+    if(!result)
+    {
+        for(titr = postris + postrioffsets[from]; titr != tend; ++titr)
+        {
+            const uint32_t* t = tris + (*titr)*3;
+            wedgemap[t[0]] = ~0U;
+            wedgemap[t[1]] = ~0U;
+            wedgemap[t[2]] = ~0U;
+        }
+    }
+    return result;
+}
 
-    strncpy(vs->name, name, sizeof(vs->name));
-    vs->name[sizeof(vs->name) - 1] = '\0';
-    vs->usage = usage;
-    vs->set = set;
-    vs->valuetype = valuetype;
-    vs->numcomponents = numcomponents;
-    vs->indexmapping = indexmapping;
-    taa_scenemesh_resize_vertices(vs, stride, numvertices);
-    bufsize = numvertices * stride;
-    if(srcbuffer != NULL)
+//****************************************************************************
+static int taa_scenemesh_cmp_collapse(
+    const void* a,
+    const void* b)
+{
+    // sorts ascending by cost, and by position to keep it stable
+    const taa_scenemesh_collapse* ca = (const taa_scenemesh_collapse*) a;
+    const taa_scenemesh_collapse* cb = (const taa_scenemesh_collapse*) b;
+    int result;
+    if(ca->cost != cb->cost)
     {
-        memcpy(vs->buffer, srcbuffer, bufsize);
+        result = (ca->cost < cb->cost) ? -1 : 1;
+    }
+    else if(ca->from != cb->from)
+    {
+        result = (ca->from < cb->from) ? -1 : 1;
     }
     else
     {
-        memset(vs->buffer, 0, bufsize);
+        result = (ca->to < cb->to) ? -1 : ((ca->to > cb->to) ? 1 : 0);
     }
+    return result;
+}
 
-    if(indexmapping >= mesh->indexsize)
+//****************************************************************************
+static int taa_scenemesh_cmp_overdrawkey(
+    const void* a,
+    const void* b)
+{
+    // sorts descending by key, and ascending by cluster to keep it stable
+    const taa_scenemesh_overdrawkey* ka = (const taa_scenemesh_overdrawkey*) a;
+    const taa_scenemesh_overdrawkey* kb = (const taa_scenemesh_overdrawkey*) b;
+    int result;
+    if(ka->key != kb->key)
     {
-        mesh->indexsize = indexmapping + 1;
+        result = (ka->key > kb->key) ? -1 : 1;
     }
-
-    return vsid;
+    else
+    {
+        result = (ka->cluster < kb->cluster) ? -1 : 1;
+    }
+    return result;
 }
 
 //****************************************************************************
-int taa_scenemesh_add_vertex(
-    taa_scenemesh_stream* vs,
-    const void* vertdata)
+static void taa_scenemesh_copy_arena(
+    const taa_scenemesh_arena* arena,
+    void* dst)
 {
-    int index = vs->numvertices;
-    int stride = vs->stride;
-    taa_scenemesh_resize_vertices(vs, stride, index + 1);
-    memcpy(((uint8_t*) vs->buffer) + stride*index, vertdata, stride);
-    return index;
+    const taa_scenemesh_chunk* chunk = arena->first;
+    uint8_t* dstitr = (uint8_t*) dst;
+    while(chunk != NULL)
+    {
+        memcpy(dstitr, chunk + 1, chunk->size);
+        dstitr += chunk->size;
+        chunk = chunk->next;
+    }
 }
 
 //****************************************************************************
-void taa_scenemesh_begin_binding(
-    taa_scenemesh* mesh,
-    const char* name,
-    int matid)
+static uint32_t taa_scenemesh_count_new_verts(
+    const uint32_t* tri,
+    const uint32_t* vertlocal)
 {
-    int i = mesh->numbindings;
-    taa_scenemesh_binding* binding;
-    taa_scenemesh_resize_bindings(mesh, i + 1);
-    binding = mesh->bindings + i;
-    strncpy(binding->name, name, sizeof(binding->name)-1);
-    binding->materialid = matid;
-    binding->firstface = mesh->numfaces;
-    binding->numfaces = 0;
+    // counts the distinct vertices of a triangle not yet in a meshlet
+    uint32_t n = 0;
+    n += (vertlocal[tri[0]] == ~0U);
+    n += (vertlocal[tri[1]] == ~0U) && (tri[1] != tri[0]);
+    n += (vertlocal[tri[2]] == ~0U) && (tri[2] != tri[0]) &&
+         (tri[2] != tri[1]);
+    return n;
 }
 
 //****************************************************************************
-void taa_scenemesh_create(
-    const char* name,
-    taa_scenemesh* mesh_out)
+static float taa_scenemesh_decode_half(
+    uint16_t h)
 {
-    memset(mesh_out, 0, sizeof(*mesh_out));
-    if(name != NULL)
+    union { float f; uint32_t u; } v;
+    uint32_t sign = ((uint32_t) (h & 0x8000)) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    if(exp == 0)
     {
-        strncpy(mesh_out->name, name, sizeof(mesh_out->name));
-        mesh_out->name[sizeof(mesh_out->name)-1] = '\0';
+        if(mant == 0)
+        {
+            // signed zero
+            v.u = sign;
+        }
+        else
+        {
+            // denormal, renormalize for float
+            exp = 127 - 15 + 1;
+            while((mant & 0x400) == 0)
+            {
+                mant <<= 1;
+                --exp;
+            }
+            v.u = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+        }
     }
-    mesh_out->skeleton = -1;
+    else if(exp == 0x1f)
+    {
+        // infinity or nan
+        v.u = sign | 0x7f800000 | (mant << 13);
+    }
+    else
+    {
+        v.u = sign | ((exp + (127 - 15)) << 23) | (mant << 13);
+    }
+    return v.f;
 }
 
 //****************************************************************************
-void taa_scenemesh_destroy(
-    taa_scenemesh* mesh)
+static void taa_scenemesh_decode_octahedral(
+    float u,
+    float v,
+    float* n_out)
 {
-    taa_scenemesh_stream* vsitr = mesh->vertexstreams;
-    taa_scenemesh_stream* vsend = vsitr + mesh->numstreams;
-    // free aligned allocations
-    while(vsitr != vsend)
+    // maps a point on the octahedron back to a unit vector
+    float x = u;
+    float y = v;
+    float z = 1.0f - fabsf(u) - fabsf(v);
+    float len;
+    if(z < 0.0f)
     {
-        taa_memalign_free(vsitr->buffer);
-        ++vsitr;
+        x = (1.0f - fabsf(v)) * ((u >= 0.0f) ? 1.0f : -1.0f);
+        y = (1.0f - fabsf(u)) * ((v >= 0.0f) ? 1.0f : -1.0f);
     }
-    taa_memalign_free(mesh->joints);
-    // free normal allocations
-    free(mesh->indices);
-    free(mesh->faces);
-    free(mesh->bindings);
-    free(mesh->vertexstreams);
+    len = sqrtf(x*x + y*y + z*z);
+    n_out[0] = x / len;
+    n_out[1] = y / len;
+    n_out[2] = z / len;
 }
 
 //****************************************************************************
-void taa_scenemesh_end_binding(
-    taa_scenemesh* mesh)
+static double taa_scenemesh_decode_value(
+    taa_scenemesh_valuetype valuetype,
+    const void* src)
 {
-    taa_scenemesh_binding* binding;
-    binding = mesh->bindings + (mesh->numbindings - 1);
-    binding->numfaces = mesh->numfaces - binding->firstface;
+    double d = 0.0;
+    switch(valuetype)
+    {
+    case taa_SCENEMESH_VALUE_FLOAT32: d = *((const float*)    src); break;
+    case taa_SCENEMESH_VALUE_FLOAT64: d = *((const double*)   src); break;
+    case taa_SCENEMESH_VALUE_INT8:    d = *((const int8_t*)   src); break;
+    case taa_SCENEMESH_VALUE_INT16:   d = *((const int16_t*)  src); break;
+    case taa_SCENEMESH_VALUE_INT32:   d = *((const int32_t*)  src); break;
+    case taa_SCENEMESH_VALUE_UINT8:   d = *((const uint8_t*)  src); break;
+    case taa_SCENEMESH_VALUE_UINT16:  d = *((const uint16_t*) src); break;
+    case taa_SCENEMESH_VALUE_UINT32:  d = *((const uint32_t*) src); break;
+    case taa_SCENEMESH_VALUE_MERGED:  assert(0); break;
+    case taa_SCENEMESH_VALUE_FLOAT16:
+        d = taa_scenemesh_decode_half(*((const uint16_t*) src));
+        break;
+    case taa_SCENEMESH_VALUE_SNORM8:
+        d = *((const int8_t*) src) / 127.0;
+        d = (d < -1.0) ? -1.0 : d;
+        break;
+    case taa_SCENEMESH_VALUE_SNORM16:
+        d = *((const int16_t*) src) / 32767.0;
+        d = (d < -1.0) ? -1.0 : d;
+        break;
+    case taa_SCENEMESH_VALUE_UNORM8:
+        d = *((const uint8_t*) src) / 255.0;
+        break;
+    case taa_SCENEMESH_VALUE_UNORM16:
+        d = *((const uint16_t*) src) / 65535.0;
+        break;
+    }
+    return d;
 }
 
 //****************************************************************************
-int taa_scenemesh_find_binding(
+static uint32_t taa_scenemesh_duplicate_vertex(
     taa_scenemesh* mesh,
-    const char* name)
+    uint32_t vertex,
+    uint8_t* vertbuf)
 {
-    int result = -1;
-    taa_scenemesh_binding* bitr = mesh->bindings;
-    taa_scenemesh_binding* bend = bitr + mesh->numbindings;
-    while(bitr != bend)
+    // appends a copy of a vertex to every stream of a mesh with merged
+    // indices, and returns the index of the copy. vertbuf must hold the
+    // largest stride of the streams.
+    uint32_t copy = mesh->vertexstreams[0].numvertices;
+    uint32_t i;
+    for(i = 0; i < mesh->numstreams; ++i)
     {
-        if(!strcmp(bitr->name, name))
-        {
-            result = (int)(ptrdiff_t) (bitr - mesh->bindings);
-            break;
-        }
-        ++bitr;
+        taa_scenemesh_stream* vs = mesh->vertexstreams + i;
+        memcpy(vertbuf, vs->buffer + vertex*vs->stride, vs->stride);
+        taa_scenemesh_add_vertex(vs, vertbuf);
     }
-    return result;
+    return copy;
 }
 
 //****************************************************************************
-int taa_scenemesh_find_stream(
-    taa_scenemesh* mesh,
-    taa_scenemesh_usage usage,
-    uint32_t set)
+static uint16_t taa_scenemesh_encode_half(
+    float f)
 {
-    int result = -1;
-    taa_scenemesh_stream* vsitr = mesh->vertexstreams;
-    taa_scenemesh_stream* vsend = vsitr + mesh->numstreams;
-    while(vsitr != vsend)
+    union { float f; uint32_t u; } v;
+    uint32_t sign;
+    uint32_t mant;
+    int32_t exp;
+    uint16_t h;
+    v.f = f;
+    sign = (v.u >> 16) & 0x8000;
+    exp = (int32_t) ((v.u >> 23) & 0xff);
+    mant = v.u & 0x7fffff;
+    if(exp == 0xff)
     {
-        if(vsitr->usage == usage && vsitr->set == set)
+        // infinity or nan, keep nans quiet
+        h = (uint16_t) (sign | 0x7c00 | ((mant != 0) ? 0x200 : 0));
+    }
+    else
+    {
+        exp = exp - 127 + 15;
+        if(exp >= 0x1f)
         {
-            result = (int)(ptrdiff_t) (vsitr - mesh->vertexstreams);
-            break;
+            // overflow to infinity
+            h = (uint16_t) (sign | 0x7c00);
+        }
+        else if(exp <= 0)
+        {
+            if(exp < -10)
+            {
+                // underflow to signed zero
+                h = (uint16_t) sign;
+            }
+            else
+            {
+                // denormal, round to nearest even
+                uint32_t shift = (uint32_t) (14 - exp);
+                uint32_t halfway = 1U << (shift - 1);
+                uint32_t rem;
+                mant |= 0x800000;
+                rem = mant & ((1U << shift) - 1);
+                h = (uint16_t) (sign | (mant >> shift));
+                if(rem > halfway || (rem == halfway && (h & 1) != 0))
+                {
+                    ++h;
+                }
+            }
+        }
+        else
+        {
+            // normal, round to nearest even. a carry out of the mantissa
+            // correctly increments the exponent, or overflows to infinity
+            uint32_t rem = mant & 0x1fff;
+            h = (uint16_t) (sign | (exp << 10) | (mant >> 13));
+            if(rem > 0x1000 || (rem == 0x1000 && (h & 1) != 0))
+            {
+                ++h;
+            }
         }
-        ++vsitr;
     }
-    return result;
+    return h;
 }
 
+#ifdef taa_SCENEMESH_SSE2
 //****************************************************************************
-int taa_scenemesh_find_vertex(
-    const taa_scenemesh_stream* vs,
-    const void* vertdata)
+static __m128i taa_scenemesh_encode_half4(
+    __m128 f)
 {
-    int index = -1;
-    int stride = vs->stride;
-    const uint8_t* vitr = vs->buffer;
-    const uint8_t* vend = vs->buffer + (stride * vs->numvertices);
-    while(vitr != vend)
+    // converts 4 floats to half floats in the low 16 bits of each lane,
+    // with the same rounding and special values as encode_half
+    __m128i minnormal = _mm_set1_epi32((127 - 14) << 23);
+    __m128i maxfinite = _mm_set1_epi32((127 + 16) << 23);
+    __m128i submagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+    __m128i normalbias = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+    __m128 sign = _mm_and_ps(f, _mm_castsi128_ps(_mm_set1_epi32(0x80000000)));
+    __m128 absf = _mm_xor_ps(f, sign);
+    __m128i absi = _mm_castps_si128(absf);
+    __m128i isnan = _mm_castps_si128(_mm_cmpunord_ps(absf, absf));
+    __m128i isregular = _mm_cmpgt_epi32(maxfinite, absi);
+    __m128i issub = _mm_cmpgt_epi32(minnormal, absi);
+    __m128i special;
+    __m128i sub;
+    __m128i normal;
+    __m128i odd;
+    __m128i h;
+    // infinity, or a quiet nan
+    special = _mm_or_si128(
+        _mm_and_si128(isnan, _mm_set1_epi32(0x200)),
+        _mm_set1_epi32(0x7c00));
+    // denormals are rounded by the float addition
+    sub = _mm_castps_si128(_mm_add_ps(absf, _mm_castsi128_ps(submagic)));
+    sub = _mm_sub_epi32(sub, submagic);
+    // normals rebias the exponent and round to nearest even
+    odd = _mm_srai_epi32(_mm_slli_epi32(absi, 31 - 13), 31);
+    normal = _mm_sub_epi32(_mm_add_epi32(absi, normalbias), odd);
+    normal = _mm_srli_epi32(normal, 13);
+    h = _mm_or_si128(
+        _mm_and_si128(issub, sub),
+        _mm_andnot_si128(issub, normal));
+    h = _mm_or_si128(
+        _mm_and_si128(isregular, h),
+        _mm_andnot_si128(isregular, special));
+    return _mm_or_si128(h, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+}
+#endif
+
+//****************************************************************************
+static void taa_scenemesh_encode_value(
+    taa_scenemesh_valuetype valuetype,
+    double d,
+    void* dst)
+{
+    // normalized types clamp nan to the low end of their range
+    switch(valuetype)
     {
-        if(!memcmp(vertdata, vitr, stride))
-        {
-            index = (int) ((ptrdiff_t) (vitr - vs->buffer))/stride;
-            break;
-        }
-        vitr += stride;
+    case taa_SCENEMESH_VALUE_FLOAT32: *((float*)    dst) = (float)    d; break;
+    case taa_SCENEMESH_VALUE_FLOAT64: *((double*)   dst) =            d; break;
+    case taa_SCENEMESH_VALUE_INT8:    *((int8_t*)   dst) = (int8_t)   d; break;
+    case taa_SCENEMESH_VALUE_INT16:   *((int16_t*)  dst) = (int16_t)  d; break;
+    case taa_SCENEMESH_VALUE_INT32:   *((int32_t*)  dst) = (int32_t)  d; break;
+    case taa_SCENEMESH_VALUE_UINT8:   *((uint8_t*)  dst) = (uint8_t)  d; break;
+    case taa_SCENEMESH_VALUE_UINT16:  *((uint16_t*) dst) = (uint16_t) d; break;
+    case taa_SCENEMESH_VALUE_UINT32:  *((uint32_t*) dst) = (uint32_t) d; break;
+    case taa_SCENEMESH_VALUE_MERGED:  assert(0); break;
+    case taa_SCENEMESH_VALUE_FLOAT16:
+        *((uint16_t*) dst) = taa_scenemesh_encode_half((float) d);
+        break;
+    case taa_SCENEMESH_VALUE_SNORM8:
+        d = (d > 1.0) ? 1.0 : ((d >= -1.0) ? d : -1.0);
+        *((int8_t*) dst) = (int8_t) floor(d * 127.0 + 0.5);
+        break;
+    case taa_SCENEMESH_VALUE_SNORM16:
+        d = (d > 1.0) ? 1.0 : ((d >= -1.0) ? d : -1.0);
+        *((int16_t*) dst) = (int16_t) floor(d * 32767.0 + 0.5);
+        break;
+    case taa_SCENEMESH_VALUE_UNORM8:
+        d = (d > 1.0) ? 1.0 : ((d >= 0.0) ? d : 0.0);
+        *((uint8_t*) dst) = (uint8_t) floor(d * 255.0 + 0.5);
+        break;
+    case taa_SCENEMESH_VALUE_UNORM16:
+        d = (d > 1.0) ? 1.0 : ((d >= 0.0) ? d : 0.0);
+        *((uint16_t*) dst) = (uint16_t) floor(d * 65535.0 + 0.5);
+        break;
     }
-    return index;
-}    
+}
 
 //****************************************************************************
-void taa_scenemesh_format(
-    taa_scenemesh* mesh,
-    const taa_scenemesh_vertformat* vf,
-    int numvf)
+static void taa_scenemesh_encode_octahedral(
+    const float* n,
+    taa_scenemesh_valuetype valuetype,
+    void* dst)
 {
-    const taa_scenemesh_vertformat* vfitr;
-    const taa_scenemesh_vertformat* vfend;
-    unsigned int i;
-    // remove unused vertex streams
-    i = 0;
-    while(i < mesh->numstreams)
+    // projects the vector onto the octahedron, folds the lower hemisphere
+    // over the upper, then picks whichever of the four surrounding grid
+    // points decodes closest to the original direction
+    int compsize = taa_scenemesh_calc_stride(valuetype, 1);
+    float range = (valuetype == taa_SCENEMESH_VALUE_SNORM8) ? 127.0f:32767.0f;
+    float l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+    float nrm[3];
+    float u;
+    float v;
+    float bestdot = -2.0f;
+    float bestu = 0.0f;
+    float bestv = 0.0f;
+    float len;
+    int i;
+    assert(valuetype == taa_SCENEMESH_VALUE_SNORM8 ||
+           valuetype == taa_SCENEMESH_VALUE_SNORM16);
+    l1 = (l1 > 0.0f) ? l1 : 1.0f;
+    u = n[0] / l1;
+    v = n[1] / l1;
+    if(n[2] < 0.0f)
     {
-        taa_scenemesh_stream* vs = mesh->vertexstreams + i;
-        vfitr = vf;
-        vfend = vfitr + numvf;
-        while(vfitr != vfend)
+        float fu = (1.0f - fabsf(v)) * ((u >= 0.0f) ? 1.0f : -1.0f);
+        float fv = (1.0f - fabsf(u)) * ((v >= 0.0f) ? 1.0f : -1.0f);
+        u = fu;
+        v = fv;
+    }
+    len = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+    len = (len > 0.0f) ? len : 1.0f;
+    nrm[0] = n[0] / len;
+    nrm[1] = n[1] / len;
+    nrm[2] = n[2] / len;
+    for(i = 0; i < 4; ++i)
+    {
+        float cu = ((i & 1) ? ceilf(u * range) : floorf(u * range)) / range;
+        float cv = ((i & 2) ? ceilf(v * range) : floorf(v * range)) / range;
+        float dec[3];
+        float dot;
+        taa_scenemesh_decode_octahedral(cu, cv, dec);
+        dot = dec[0]*nrm[0] + dec[1]*nrm[1] + dec[2]*nrm[2];
+        if(dot > bestdot)
         {
-            if(vfitr->usage == vs->usage && vfitr->set == vs->set)
-            {
-                break;
-            }
-            ++vfitr;
+            bestdot = dot;
+            bestu = cu;
+            bestv = cv;
         }
-        if(vfitr == vfend)
+    }
+    taa_scenemesh_encode_value(valuetype, bestu, dst);
+    taa_scenemesh_encode_value(valuetype, bestv, ((uint8_t*) dst) + compsize);
+}
+
+//****************************************************************************
+static float taa_scenemesh_eval_quadric(
+    const taa_scenemesh_quadric* q,
+    const float* p)
+{
+    // returns the weighted mean of the squared plane distances
+    double x = p[0];
+    double y = p[1];
+    double z = p[2];
+    double e;
+    e = q->a2*x*x + q->b2*y*y + q->c2*z*z + q->d2 +
+        2.0*(q->ab*x*y + q->ac*x*z + q->bc*y*z) +
+        2.0*(q->ad*x + q->bd*y + q->cd*z);
+    e = (e > 0.0) ? e : 0.0;
+    return (q->w > 0.0) ? (float) (e / q->w) : 0.0f;
+}
+
+//****************************************************************************
+static void taa_scenemesh_finish_meshlet(
+    const taa_scenemesh* mesh,
+    const float* positions,
+    float* normals,
+    uint32_t* vertlocal,
+    taa_scenemesh_meshlet* meshlet)
+{
+    const uint32_t* verts = mesh->meshletvertices + meshlet->firstvertex;
+    const uint8_t* indices = mesh->meshletindices + meshlet->firstindex;
+    uint32_t numverts = meshlet->numvertices;
+    uint32_t numtris = meshlet->numtriangles;
+    float* center = meshlet->center;
+    float* axis = meshlet->coneaxis;
+    uint32_t pmin[3];
+    uint32_t pmax[3];
+    float radius;
+    float maxdist;
+    float mindp;
+    float len;
+    uint32_t i;
+    uint32_t j;
+
+    // release the vertices for the next meshlet
+    for(i = 0; i < numverts; ++i)
+    {
+        vertlocal[verts[i]] = ~0U;
+    }
+    meshlet->conecutoff = 1.0f;
+    if(positions == NULL)
+    {
+        return;
+    }
+
+    // start the bounding sphere with the most distant pair of axis aligned
+    // extremes, then grow it to contain every vertex (Ritter's method)
+    pmin[0] = pmin[1] = pmin[2] = 0;
+    pmax[0] = pmax[1] = pmax[2] = 0;
+    for(i = 1; i < numverts; ++i)
+    {
+        const float* p = positions + verts[i]*3;
+        for(j = 0; j < 3; ++j)
         {
-            taa_scenemesh_remove_stream(mesh, vs);
+            if(p[j] < positions[verts[pmin[j]]*3 + j]) pmin[j] = i;
+            if(p[j] > positions[verts[pmax[j]]*3 + j]) pmax[j] = i;
         }
-        else
+    }
+    maxdist = -1.0f;
+    for(j = 0; j < 3; ++j)
+    {
+        const float* pa = positions + verts[pmin[j]]*3;
+        const float* pb = positions + verts[pmax[j]]*3;
+        float d[3];
+        float dist;
+        d[0] = pb[0] - pa[0];
+        d[1] = pb[1] - pa[1];
+        d[2] = pb[2] - pa[2];
+        dist = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+        if(dist > maxdist)
         {
-            ++i;
+            maxdist = dist;
+            center[0] = (pa[0] + pb[0]) * 0.5f;
+            center[1] = (pa[1] + pb[1]) * 0.5f;
+            center[2] = (pa[2] + pb[2]) * 0.5f;
         }
     }
-    // if any of the source streams are missing, fill them in
-    vfitr = vf;
-    vfend = vfitr + numvf;
-    while(vfitr != vfend)
+    radius = sqrtf(maxdist) * 0.5f;
+    for(i = 0; i < numverts; ++i)
     {
-        if(taa_scenemesh_find_stream(mesh,vfitr->usage,vfitr->set) < 0)
+        const float* p = positions + verts[i]*3;
+        float d[3];
+        float dist;
+        d[0] = p[0] - center[0];
+        d[1] = p[1] - center[1];
+        d[2] = p[2] - center[2];
+        dist = sqrtf(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+        if(dist > radius)
         {
-            int indexmapping = 0;
-            int numverts = 0;
-            int vs;
-            int stride;
-            if(mesh->numstreams > 0)
-            {
-                indexmapping = mesh->vertexstreams[0].indexmapping;
-                numverts = mesh->vertexstreams[0].numvertices;                
-            }
-            stride = taa_scenemesh_calc_stride(
-                vfitr->valuetype,
-                vfitr->numcomponents);
-            vs = taa_scenemesh_add_stream(
-                mesh,
-                vfitr->name,
-                vfitr->usage,
-                vfitr->set,
-                vfitr->valuetype,
-                vfitr->numcomponents,
-                stride,
-                indexmapping,
-                numverts,
-                NULL);
-            memset(mesh->vertexstreams[vs].buffer, 0, numverts*stride);
+            float k = 0.5f * (dist - radius) / dist;
+            radius = (radius + dist) * 0.5f;
+            center[0] += d[0] * k;
+            center[1] += d[1] * k;
+            center[2] += d[2] * k;
         }
-        ++vfitr;
     }
-    assert(mesh->numstreams == numvf); // stream mismatch (should not happen)
-    if(mesh->numstreams == numvf)
+    meshlet->radius = radius;
+
+    // the cone axis is the average of the unit triangle normals
+    axis[0] = axis[1] = axis[2] = 0.0f;
+    for(i = 0; i < numtris; ++i)
     {
-        taa_scenemesh_stream** mrgvs;
-        uint32_t* mrgoff;
-        void** streambufmap;
-        uint32_t nummrg;
-        vfitr = vf;
-        vfend = vfitr + numvf;
-        // reformat vertex streams
-        while(vfitr != vfend)
+        const uint8_t* t = indices + i*3;
+        float* n = normals + i*3;
+        taa_scenemesh_calc_tri_normal(
+            positions + verts[t[0]]*3,
+            positions + verts[t[1]]*3,
+            positions + verts[t[2]]*3,
+            n);
+        len = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        if(len > 0.0f)
         {
-            int32_t vs;
-            taa_scenemesh_stream* pvs;
-            vs = taa_scenemesh_find_stream(mesh, vfitr->usage, vfitr->set);
-            pvs = mesh->vertexstreams + vs;
-            assert(vs >= 0); // already should have filtered this case
-            taa_scenemesh_format_stream(
-                pvs,
-                vfitr->valuetype,
-                vfitr->numcomponents);
-            ++vfitr;
+            n[0] /= len;
+            n[1] /= len;
+            n[2] /= len;
         }
-        // convert vertices to a common set of indices
-        taa_scenemesh_merge_indices(mesh);
-        // merge streams together
-        mrgvs = (taa_scenemesh_stream**) malloc(numvf * sizeof(*mrgvs));
-        mrgoff = (uint32_t*) malloc(numvf * sizeof(*mrgoff));
-        streambufmap = (void**) malloc(numvf * sizeof(*streambufmap));
-        memset(mrgvs, 0, numvf * sizeof(*mrgvs));
-        memset(mrgoff, 0, numvf * sizeof(*mrgoff));
-        memset(streambufmap, 0, numvf * sizeof(*streambufmap));
-        i = 0;
-        do
+        axis[0] += n[0];
+        axis[1] += n[1];
+        axis[2] += n[2];
+    }
+    len = sqrtf(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+    mindp = 1.0f;
+    if(len > 0.0f)
+    {
+        axis[0] /= len;
+        axis[1] /= len;
+        axis[2] /= len;
+        for(i = 0; i < numtris; ++i)
         {
-            const char* mrgname = "";
-            taa_scenemesh_stream* pvs;
-            nummrg = 0;
-            vfitr = vf;
-            while(vfitr != vfend)
-            {
-                if(vfitr->stream == i)
-                {
-                    int32_t vs;
-                    vs = taa_scenemesh_find_stream(
-                        mesh,
-                        vfitr->usage,
-                        vfitr->set);
-                    assert(vs >= 0); // already should have filtered this case
-                    pvs = mesh->vertexstreams + vs;
-                    mrgname = (vfitr->name != NULL) ? vfitr->name : "";
-                    mrgvs[nummrg] = pvs;
-                    mrgoff[nummrg] = vfitr->offset;
-                    ++nummrg;
-                }
-                ++vfitr;
-            }
-            if(nummrg == 0)
-            {
-                // finished
-                break;
-            }
-            else if(nummrg == 1)
-            {
-                // nothing to merge
-                pvs = mrgvs[0];
-                strncpy(pvs->name, mrgname, sizeof(pvs->name));
-                pvs->name[sizeof(pvs->name)-1] = '\0';
-            }
-            else
+            const float* n = normals + i*3;
+            float dp = n[0]*axis[0] + n[1]*axis[1] + n[2]*axis[2];
+            if(n[0] != 0.0f || n[1] != 0.0f || n[2] != 0.0f)
             {
-                uint32_t vs;
-                vs = taa_scenemesh_merge_streams(
-                    mesh,
-                    mrgname,
-                    mrgvs,
-                    mrgoff,
-                    nummrg);
-                pvs = mesh->vertexstreams + vs;
+                mindp = (dp < mindp) ? dp : mindp;
             }
-            streambufmap[i] = pvs->buffer;
-            ++i;
         }
-        while(1);
-        assert(i == mesh->numstreams);
-
-        // reorder streams
-        for(i = 0; i < mesh->numstreams; ++i)
+    }
+    else
+    {
+        mindp = 0.0f;
+    }
+    if(mindp > 0.0f)
+    {
+        // move the apex back along the axis until it is behind the plane
+        // of every triangle
+        float maxt = 0.0f;
+        for(i = 0; i < numtris; ++i)
         {
-            void* bufmapping = streambufmap[i];
-            taa_scenemesh_stream vsbak = mesh->vertexstreams[i];
-            taa_scenemesh_stream* vsitr = mesh->vertexstreams;
-            while(vsitr->buffer != bufmapping)
+            const float* n = normals + i*3;
+            const float* p = positions + verts[indices[i*3]]*3;
+            float dn = n[0]*axis[0] + n[1]*axis[1] + n[2]*axis[2];
+            if(dn > 0.0f)
             {
-                assert(vsitr < mesh->vertexstreams+mesh->numstreams);
-                ++vsitr;
+                float dc = (center[0] - p[0])*n[0] +
+                           (center[1] - p[1])*n[1] +
+                           (center[2] - p[2])*n[2];
+                float t = dc / dn;
+                maxt = (t > maxt) ? t : maxt;
             }
-            // swap
-            mesh->vertexstreams[i] = *vsitr;
-            *vsitr = vsbak;
         }
-        free(streambufmap);
-        free(mrgoff);
-        free(mrgvs);
+        meshlet->coneapex[0] = center[0] - axis[0]*maxt;
+        meshlet->coneapex[1] = center[1] - axis[1]*maxt;
+        meshlet->coneapex[2] = center[2] - axis[2]*maxt;
+        meshlet->conecutoff = sqrtf(1.0f - mindp*mindp);
+    }
+    else
+    {
+        // the normals span a hemisphere or more, so it can never be culled
+        meshlet->coneapex[0] = center[0];
+        meshlet->coneapex[1] = center[1];
+        meshlet->coneapex[2] = center[2];
     }
 }
 
 //****************************************************************************
-void taa_scenemesh_format_stream(
-    taa_scenemesh_stream* vs,
-    taa_scenemesh_valuetype valuetype,
-    unsigned int numcomponents)
+static void taa_scenemesh_format_f32_f16(
+    const void* src,
+    void* dst,
+    uint32_t numvertices,
+    uint32_t numcomponents)
 {
-    unsigned int i;
-    int srccomponentsize;
-    int newcomponentsize;
-    int newstride;
-    int srcstride;
-    uint64_t srczero;
-    uint8_t* bufitr;
-    uint8_t* bufend;
-    const uint8_t* bufsrc;
-
-    // if the source vertex stream is a merged aggregate,
-    // it cannot be reformatted
-    assert(vs->valuetype != taa_SCENEMESH_VALUE_MERGED);
+    const float* sitr = (const float*) src;
+    uint16_t* ditr = (uint16_t*) dst;
+    uint16_t* dend = ditr + numvertices*numcomponents;
+#ifdef taa_SCENEMESH_SSE2
+    while(dend - ditr >= 4)
+    {
+        __m128i h = taa_scenemesh_encode_half4(_mm_loadu_ps(sitr));
+        // sign extend so the saturating pack keeps all 16 bits
+        h = _mm_srai_epi32(_mm_slli_epi32(h, 16), 16);
+        _mm_storel_epi64((__m128i*) ditr, _mm_packs_epi32(h, h));
+        sitr += 4;
+        ditr += 4;
+    }
+#endif
+    while(ditr != dend)
+    {
+        *ditr = taa_scenemesh_encode_half(*sitr);
+        ++sitr;
+        ++ditr;
+    }
+}
 
-    if(valuetype != vs->valuetype || numcomponents != vs->numcomponents)
+//****************************************************************************
+static void taa_scenemesh_format_f32_snorm16(
+    const void* src,
+    void* dst,
+    uint32_t numvertices,
+    uint32_t numcomponents)
+{
+    // rounds in double precision to match encode_value exactly
+    const float* sitr = (const float*) src;
+    int16_t* ditr = (int16_t*) dst;
+    int16_t* dend = ditr + numvertices*numcomponents;
+#if defined(taa_SCENEMESH_AVX)
+    __m256d lo = _mm256_set1_pd(-1.0);
+    __m256d hi = _mm256_set1_pd(1.0);
+    __m256d scale = _mm256_set1_pd(32767.0);
+    __m256d half = _mm256_set1_pd(0.5);
+    while(dend - ditr >= 4)
     {
-        taa_scenemesh_stream tmpvs;
-        newstride = taa_scenemesh_calc_stride(valuetype, numcomponents);
-        tmpvs = *vs;
-        tmpvs.valuetype = valuetype;
-        tmpvs.numcomponents = numcomponents;
-        tmpvs.stride = 0;
-        tmpvs.numvertices = 0;
-        tmpvs.buffer = NULL;
-        taa_scenemesh_resize_vertices(&tmpvs, newstride, vs->numvertices);
-        bufend = tmpvs.buffer + (newstride * vs->numvertices);
-
-        srczero = 0;
-        srcstride = vs->stride;
-        newcomponentsize = newstride / numcomponents;
-        srccomponentsize = vs->stride / vs->numcomponents;
-        for(i = 0; i < numcomponents; ++i)
+        __m256d v = _mm256_cvtps_pd(_mm_loadu_ps(sitr));
+        __m128i i;
+        v = _mm256_min_pd(_mm256_max_pd(v, lo), hi);
+        v = _mm256_floor_pd(_mm256_add_pd(_mm256_mul_pd(v, scale), half));
+        i = _mm256_cvttpd_epi32(v);
+        _mm_storel_epi64((__m128i*) ditr, _mm_packs_epi32(i, i));
+        sitr += 4;
+        ditr += 4;
+    }
+#elif defined(taa_SCENEMESH_SSE2)
+    __m128d lo = _mm_set1_pd(-1.0);
+    __m128d hi = _mm_set1_pd(1.0);
+    __m128d scale = _mm_set1_pd(32767.0);
+    __m128d half = _mm_set1_pd(0.5);
+    while(dend - ditr >= 4)
+    {
+        __m128 f = _mm_loadu_ps(sitr);
+        __m128d v[2];
+        __m128i i[2];
+        int j;
+        v[0] = _mm_cvtps_pd(f);
+        v[1] = _mm_cvtps_pd(_mm_movehl_ps(f, f));
+        for(j = 0; j < 2; ++j)
         {
-            bufitr = tmpvs.buffer + i*newcomponentsize;
-            bufsrc = vs->buffer + i*srccomponentsize;
-            if(i >= vs->numcomponents)
-            {
-                // if the new vertex format has more components than original,
-                // fill with zeroes
-                bufsrc = (uint8_t*) &srczero;
-                srcstride = 0;
-            }
-            taa_FORMAT(
-                vs->valuetype,
-                valuetype,
-                bufsrc,
-                bufitr,
-                bufend,
-                srcstride,
-                newstride)
+            __m128d t;
+            __m128i below;
+            v[j] = _mm_min_pd(_mm_max_pd(v[j], lo), hi);
+            v[j] = _mm_add_pd(_mm_mul_pd(v[j], scale), half);
+            // floor by truncating, then stepping down where that rounded up
+            i[j] = _mm_cvttpd_epi32(v[j]);
+            t = _mm_cvtepi32_pd(i[j]);
+            below = _mm_castpd_si128(_mm_cmpgt_pd(t, v[j]));
+            below = _mm_shuffle_epi32(below, _MM_SHUFFLE(3, 3, 2, 0));
+            i[j] = _mm_add_epi32(i[j], below);
         }
-        // apply the new format to the stream
-        taa_memalign_free(vs->buffer);
-        *vs = tmpvs;
+        i[0] = _mm_unpacklo_epi64(i[0], i[1]);
+        _mm_storel_epi64((__m128i*) ditr, _mm_packs_epi32(i[0], i[0]));
+        sitr += 4;
+        ditr += 4;
+    }
+#endif
+    while(ditr != dend)
+    {
+        taa_scenemesh_encode_value(taa_SCENEMESH_VALUE_SNORM16, *sitr, ditr);
+        ++sitr;
+        ++ditr;
     }
 }
 
 //****************************************************************************
-void taa_scenemesh_merge_indices(
-    taa_scenemesh* mesh)
+static void taa_scenemesh_format_f32x3_f32x4(
+    const void* src,
+    void* dst,
+    uint32_t numvertices,
+    uint32_t numcomponents)
 {
-    uint32_t size;
-    uint32_t indexsize;
-    uint32_t numdstindices;
-    uint32_t numbakindices;
-    uint32_t* indices;
-    uint32_t* bakindices;
-    taa_scenemesh_face* faceitr;
-    taa_scenemesh_face* faceend;
-    taa_scenemesh_stream* dststreams;
-    taa_scenemesh_stream* vsitr;
-    taa_scenemesh_stream* vsend;
-    const taa_scenemesh_stream* vssrc;
+    // expands each vertex with a zero w component
+    const float* sitr = (const float*) src;
+    float* ditr = (float*) dst;
+    float* dend = ditr + numvertices*4;
+#ifdef taa_SCENEMESH_SSE2
+    __m128 mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    // the last vertex is copied below to avoid reading past the end
+    while(dend - ditr > 4)
+    {
+        _mm_storeu_ps(ditr, _mm_and_ps(_mm_loadu_ps(sitr), mask));
+        sitr += 3;
+        ditr += 4;
+    }
+#endif
+    (void) numcomponents;
+    while(ditr != dend)
+    {
+        ditr[0] = sitr[0];
+        ditr[1] = sitr[1];
+        ditr[2] = sitr[2];
+        ditr[3] = 0.0f;
+        sitr += 3;
+        ditr += 4;
+    }
+}
 
-    // reserve a temporary buffer for recording merged indices
-    indexsize = mesh->indexsize;
-    indices = mesh->indices;
-    numdstindices = 0;
-    size = sizeof(*bakindices) * mesh->numindices;
-    bakindices = (uint32_t*) malloc(size);
-    numbakindices = 0;
+//****************************************************************************
+static void taa_scenemesh_format_f64_f32(
+    const void* src,
+    void* dst,
+    uint32_t numvertices,
+    uint32_t numcomponents)
+{
+    const double* sitr = (const double*) src;
+    float* ditr = (float*) dst;
+    float* dend = ditr + numvertices*numcomponents;
+#if defined(taa_SCENEMESH_AVX)
+    while(dend - ditr >= 4)
+    {
+        _mm_storeu_ps(ditr, _mm256_cvtpd_ps(_mm256_loadu_pd(sitr)));
+        sitr += 4;
+        ditr += 4;
+    }
+#elif defined(taa_SCENEMESH_SSE2)
+    while(dend - ditr >= 4)
+    {
+        __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(sitr));
+        __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(sitr + 2));
+        _mm_storeu_ps(ditr, _mm_movelh_ps(lo, hi));
+        sitr += 4;
+        ditr += 4;
+    }
+#endif
+    while(ditr != dend)
+    {
+        *ditr = (float) *sitr;
+        ++sitr;
+        ++ditr;
+    }
+}
 
-    // create a new set of vertex streams from the original set
-    size = sizeof(*dststreams) * mesh->numstreams;
-    dststreams = (taa_scenemesh_stream*) malloc(size);
-    vsitr = dststreams;
-    vsend = vsitr + mesh->numstreams;
-    vssrc = mesh->vertexstreams;
-    while(vsitr != vsend)
+//****************************************************************************
+static void taa_scenemesh_format_values(
+    taa_scenemesh_valuetype srctype,
+    taa_scenemesh_valuetype dsttype,
+    const uint8_t* src,
+    uint8_t* itr,
+    uint8_t* end,
+    int32_t srcinc,
+    int32_t dstinc)
+{
+    // converts one component of each vertex through a double precision
+    // value, applying the scaling of normalized and half float types
+    while(itr < end)
     {
-        memcpy(vsitr->name, vssrc->name, sizeof(vsitr->name));
-        vsitr->usage = vssrc->usage;
-        vsitr->set = vssrc->set;
-        vsitr->valuetype = vssrc->valuetype;
-        vsitr->numcomponents = vssrc->numcomponents;
-        vsitr->stride = vssrc->stride;
-        vsitr->indexmapping = 0; // all streams will use index 0 now
-        vsitr->numvertices = 0;
-        vsitr->buffer = NULL;
-        ++vssrc;
-        ++vsitr;
+        taa_scenemesh_encode_value(
+            dsttype,
+            taa_scenemesh_decode_value(srctype, src),
+            itr);
+        itr += dstinc;
+        src += srcinc;
     }
+}
 
-    // loop through all the faces and create dst faces to replace them
-    faceitr = mesh->faces;
-    faceend = faceitr + mesh->numfaces;
+//****************************************************************************
+static void taa_scenemesh_free_arena(
+    taa_scenemesh_arena* arena)
+{
+    taa_scenemesh_chunk* chunk = arena->first;
+    while(chunk != NULL)
+    {
+        taa_scenemesh_chunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->first = NULL;
+    arena->last = NULL;
+    arena->size = 0;
+}
+
+//****************************************************************************
+static void taa_scenemesh_gather_tris(
+    const taa_scenemesh* mesh,
+    const taa_scenemesh_binding* binding,
+    uint32_t* tris_out)
+{
+    // copies the triangles of a binding into a packed array
+    const taa_scenemesh_face* faceitr = mesh->faces + binding->firstface;
+    const taa_scenemesh_face* faceend = faceitr + binding->numfaces;
     while(faceitr != faceend)
     {
-        const uint32_t* indexsrc;
-        const uint32_t* indexsrcend;
+        const uint32_t* indexitr = mesh->indices + faceitr->firstindex;
+        assert(faceitr->numvertices == 3); // mesh must be triangulated
+        tris_out[0] = indexitr[0];
+        tris_out[1] = indexitr[1];
+        tris_out[2] = indexitr[2];
+        tris_out += 3;
+        ++faceitr;
+    }
+}
 
-        // loop through each vertex in the face and get the merged index
-        indexsrc = indices + faceitr->firstindex;
-        indexsrcend = indexsrc + faceitr->numindices;
-        faceitr->firstindex = numdstindices;
-        while(indexsrc != indexsrcend)
+//****************************************************************************
+static uint32_t taa_scenemesh_hash(
+    const void* data,
+    uint32_t size)
+{
+    // FNV-1a over the raw bytes, followed by a final avalanche so that the
+    // low bits are usable as a power of two table index
+    const uint8_t* itr = (const uint8_t*) data;
+    const uint8_t* end = itr + size;
+    uint32_t h = 2166136261U;
+    while(itr != end)
+    {
+        h ^= *itr;
+        h *= 16777619U;
+        ++itr;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
+    return h;
+}
+
+//****************************************************************************
+static void taa_scenemesh_merge_quadric(
+    taa_scenemesh_quadric* q,
+    const taa_scenemesh_quadric* src)
+{
+    q->a2 += src->a2;
+    q->b2 += src->b2;
+    q->c2 += src->c2;
+    q->d2 += src->d2;
+    q->ab += src->ab;
+    q->ac += src->ac;
+    q->ad += src->ad;
+    q->bc += src->bc;
+    q->bd += src->bd;
+    q->cd += src->cd;
+    q->w += src->w;
+}
+
+//****************************************************************************
+static void taa_scenemesh_optimize_tris_vcache(
+    uint32_t* tris,
+    uint32_t numtris,
+    uint32_t numverts,
+    uint32_t* order_out)
+{
+    // linear speed vertex cache optimization, as described by Tom Forsyth.
+    // tris holds local vertex ids in the range [0, numverts). the new
+    // triangle order is written to order_out.
+    enum { CACHESIZE = taa_SCENEMESH_VCACHE_SIZE };
+    float cachescores[CACHESIZE];
+    float valencescores[taa_SCENEMESH_VCACHE_MAXVALENCE];
+    uint32_t cache[CACHESIZE + 3];
+    uint32_t newcache[CACHESIZE + 3];
+    uint32_t cachesize;
+    uint32_t* vnumtris;
+    uint32_t* vfirsttri;
+    uint32_t* vtris;
+    float* vscores;
+    float* tscores;
+    uint8_t* tadded;
+    uint32_t numemitted;
+    uint32_t scanpos;
+    int32_t besttri;
+    uint32_t i;
+    uint32_t j;
+
+    // precompute the score tables
+    for(i = 0; i < CACHESIZE; ++i)
+    {
+        if(i < 3)
+        {
+            // the last triangle added gets a fixed score so that strips
+            // are not favored over fans
+            cachescores[i] = 0.75f;
+        }
+        else
         {
-            uint32_t* bakitr;
-            uint32_t* bakend;
-            int32_t dstindex = -1;
+            float s = 1.0f - ((float) (i - 3)) / (CACHESIZE - 3);
+            cachescores[i] = (float) pow(s, 1.5);
+        }
+    }
+    valencescores[0] = -1.0f;
+    for(i = 1; i < taa_SCENEMESH_VCACHE_MAXVALENCE; ++i)
+    {
+        // boost vertices with few remaining triangles to avoid leaving
+        // isolated triangles behind
+        valencescores[i] = 2.0f * (float) pow((double) i, -0.5);
+    }
 
-            // try to find a matching vertex combination from a previous face
-            bakitr = bakindices;
-            bakend = bakitr + numbakindices*indexsize;
-            while(bakitr != bakend)
+    vnumtris = (uint32_t*) calloc(numverts, sizeof(*vnumtris));
+    vfirsttri = (uint32_t*) malloc(numverts * sizeof(*vfirsttri));
+    vtris = (uint32_t*) malloc(numtris * 3 * sizeof(*vtris));
+    vscores = (float*) malloc(numverts * sizeof(*vscores));
+    tscores = (float*) malloc(numtris * sizeof(*tscores));
+    tadded = (uint8_t*) calloc(numtris, sizeof(*tadded));
+
+    // build vertex to triangle adjacency
+    for(i = 0; i < numtris * 3; ++i)
+    {
+        ++vnumtris[tris[i]];
+    }
+    j = 0;
+    for(i = 0; i < numverts; ++i)
+    {
+        vfirsttri[i] = j;
+        j += vnumtris[i];
+        vnumtris[i] = 0;
+    }
+    for(i = 0; i < numtris * 3; ++i)
+    {
+        uint32_t v = tris[i];
+        vtris[vfirsttri[v] + vnumtris[v]++] = i / 3;
+    }
+
+    // initial scores
+    for(i = 0; i < numverts; ++i)
+    {
+        uint32_t valence = vnumtris[i];
+        if(valence >= taa_SCENEMESH_VCACHE_MAXVALENCE)
+        {
+            valence = taa_SCENEMESH_VCACHE_MAXVALENCE - 1;
+        }
+        vscores[i] = valencescores[valence];
+    }
+    besttri = -1;
+    for(i = 0; i < numtris; ++i)
+    {
+        const uint32_t* t = tris + i*3;
+        tscores[i] = vscores[t[0]] + vscores[t[1]] + vscores[t[2]];
+        if(besttri < 0 || tscores[i] > tscores[besttri])
+        {
+            besttri = i;
+        }
+    }
+
+    cachesize = 0;
+    scanpos = 0;
+    for(numemitted = 0; numemitted < numtris; ++numemitted)
+    {
+        const uint32_t* t;
+        uint32_t newcachesize;
+        float bestscore;
+        if(besttri < 0)
+        {
+            // no candidates in the cache, take the next triangle that has
+            // not been added. the scan position only moves forward, so the
+            // fallback stays linear over the whole optimization.
+            while(tadded[scanpos])
+            {
+                ++scanpos;
+            }
+            besttri = scanpos;
+        }
+        order_out[numemitted] = besttri;
+        tadded[besttri] = 1;
+        t = tris + besttri*3;
+
+        // remove the triangle from the adjacency of its vertices
+        for(i = 0; i < 3; ++i)
+        {
+            uint32_t* vtitr = vtris + vfirsttri[t[i]];
+            uint32_t* vtend = vtitr + vnumtris[t[i]];
+            while(vtitr != vtend)
             {
-                if(!memcmp(bakitr,indexsrc,sizeof(*bakitr)*indexsize))
+                if(*vtitr == (uint32_t) besttri)
                 {
-                    dstindex=((uint32_t)(bakitr-bakindices))/indexsize;
+                    *vtitr = *(vtend - 1);
+                    --vnumtris[t[i]];
                     break;
                 }
-                bakitr += indexsize;
+                ++vtitr;
             }
+        }
 
-            if(dstindex == -1)
+        // move the triangle's vertices to the front of the cache
+        newcachesize = 0;
+        for(i = 0; i < 3; ++i)
+        {
+            newcache[newcachesize++] = t[i];
+        }
+        for(i = 0; i < cachesize; ++i)
+        {
+            uint32_t v = cache[i];
+            if(v != t[0] && v != t[1] && v != t[2])
             {
-                // no matching vertex combination found, create a dst vertex
-                dstindex = numbakindices++;
-                // map the merged index to the old combination
-                size = sizeof(*bakindices) * numbakindices * indexsize;
-                bakindices = (uint32_t*) realloc(bakindices, size);
-                size = sizeof(*bakindices) * indexsize;
-                bakitr = bakindices + dstindex*indexsize;
-                bakend = bakitr + indexsize;
-                memcpy(bakitr, indexsrc, size);
-                // copy the vertex data to the vertex streams
-                vsitr = dststreams;
-                vsend = vsitr + mesh->numstreams;
-                vssrc = mesh->vertexstreams;
-                while(vsitr != vsend)
+                newcache[newcachesize++] = v;
+            }
+        }
+
+        // update the scores of every vertex that was in either cache
+        for(i = 0; i < newcachesize; ++i)
+        {
+            uint32_t v = newcache[i];
+            uint32_t valence = vnumtris[v];
+            float score = -1.0f;
+            if(valence > 0)
+            {
+                if(valence >= taa_SCENEMESH_VCACHE_MAXVALENCE)
+                {
+                    valence = taa_SCENEMESH_VCACHE_MAXVALENCE - 1;
+                }
+                score = valencescores[valence];
+                if(i < CACHESIZE)
                 {
-                    const uint8_t* vertsrc;
-                    uint8_t* vertBuf;
-                    uint32_t* bakidx = bakitr + vssrc->indexmapping;
-                    assert(bakidx < bakend); // index buffer overflow
-                    // dst vert goes at end of vertex buffer
-                    taa_scenemesh_resize_vertices(
-                        vsitr,
-                        vsitr->stride,
-                        vsitr->numvertices+1);
-                    size = vsitr->stride * vsitr->numvertices;
-                    vertBuf = vsitr->buffer + (size - vsitr->stride);
-                    // old vert comes from data at index in old buffer
-                    vertsrc = vssrc->buffer + (vssrc->stride * (*bakidx));
-                    assert(*bakidx < vssrc->numvertices); // bad index
-                    memcpy(vertBuf, vertsrc, vsitr->stride);
-                    ++vssrc;
-                    ++vsitr;
+                    score += cachescores[i];
                 }
             }
-            indices[numdstindices++] = dstindex;
-            indexsrc += indexsize;
+            vscores[v] = score;
         }
-        faceitr->numindices = numdstindices - faceitr->firstindex;
-        faceitr->numvertices = faceitr->numindices;
-        ++faceitr;
+        // then rescore the remaining triangles that use those vertices
+        besttri = -1;
+        bestscore = -1.0f;
+        for(i = 0; i < newcachesize; ++i)
+        {
+            uint32_t v = newcache[i];
+            uint32_t* vtitr = vtris + vfirsttri[v];
+            uint32_t* vtend = vtitr + vnumtris[v];
+            while(vtitr != vtend)
+            {
+                const uint32_t* vt = tris + (*vtitr)*3;
+                float tscore = vscores[vt[0]]+vscores[vt[1]]+vscores[vt[2]];
+                tscores[*vtitr] = tscore;
+                if(tscore > bestscore)
+                {
+                    besttri = *vtitr;
+                    bestscore = tscore;
+                }
+                ++vtitr;
+            }
+        }
+        cachesize = (newcachesize < CACHESIZE) ? newcachesize : CACHESIZE;
+        memcpy(cache, newcache, cachesize * sizeof(*cache));
     }
 
-    // clean up the temporary buffer for holding the merged indices
-    free(bakindices);
-    mesh->numindices = numdstindices;
+    free(tadded);
+    free(tscores);
+    free(vscores);
+    free(vtris);
+    free(vfirsttri);
+    free(vnumtris);
+}
 
-    // clean up the old vertex streams and replace with the new streams
-    vsitr = mesh->vertexstreams;
-    vsend = vsitr + mesh->numstreams;
-    while(vsitr != vsend)
+//****************************************************************************
+static uint32_t taa_scenemesh_probe_edge(
+    const uint64_t* edgekeys,
+    uint32_t edgemask,
+    uint32_t a,
+    uint32_t b)
+{
+    // returns the slot of the edge, or the empty slot where it belongs
+    uint64_t key = (a < b) ?
+        (((uint64_t) a) << 32) | b :
+        (((uint64_t) b) << 32) | a;
+    uint32_t h = taa_scenemesh_hash(&key, sizeof(key)) & edgemask;
+    while(edgekeys[h] != key && edgekeys[h] != ~((uint64_t) 0))
     {
-        taa_memalign_free(vsitr->buffer);
-        ++vsitr;
+        h = (h + 1) & edgemask;
     }
-    free(mesh->vertexstreams);
-    mesh->vertexstreams = dststreams;
-
-    mesh->indexsize = 1; // only one index per vertex now
+    return h;
 }
 
 //****************************************************************************
-int taa_scenemesh_merge_streams(
-    taa_scenemesh* mesh,
-    const char* name,
-    taa_scenemesh_stream** streams,
-    const uint32_t* streamoffsets,
-    uint32_t numstreams)
+static uint32_t* taa_scenemesh_probe_vertexhash(
+    const taa_scenemesh_stream* vs,
+    const void* vertdata)
 {
-    uint32_t newnumstreams;
-    taa_scenemesh_stream* vsnew;
-    taa_scenemesh_stream** vssrcitr;
-    taa_scenemesh_stream** vssrcend;
-    taa_scenemesh_stream* vssrc;
-    taa_scenemesh_stream* vsitr;
-    taa_scenemesh_stream* vsend;
-    const uint32_t* offitr;
-
-    assert(numstreams <= mesh->numstreams); // too many streams
-
-    // create the merged stream
-    vsnew = (taa_scenemesh_stream*) malloc(sizeof(*vsnew));
-    strncpy(vsnew->name, name, sizeof(vsnew->name) - 1);
-    vsnew->name[sizeof(vsnew->name) - 1] = '\0';
-    vsnew->usage = taa_SCENEMESH_USAGE_MERGED;
-    vsnew->set = 0;
-    vsnew->valuetype = taa_SCENEMESH_VALUE_MERGED;
-    vsnew->numcomponents = 1;
-    vsnew->stride = 0;
-    vsnew->indexmapping = 0;
-    vsnew->numvertices = 0;
-    vsnew->buffer = NULL;
-
-    // determine stride, index offset, and vertex count of the merged stream
-    vssrcitr = streams;
-    vssrcend = vssrcitr + numstreams;
-    offitr = streamoffsets;
-    while(vssrcitr != vssrcend)
+    // returns the slot holding the first matching vertex, or the empty
+    // slot where the vertex belongs if there is no match
+    uint32_t stride = vs->stride;
+    uint32_t mask = vs->vertexhashsize - 1;
+    uint32_t* table = vs->vertexhash;
+    uint32_t h = taa_scenemesh_hash(vertdata, stride) & mask;
+    while(table[h] != ~0U)
     {
-        vssrc = *vssrcitr;
-        // all the merged streams should share the same index
-        assert(vssrc->indexmapping==vsnew->indexmapping || vssrcitr==streams);
-        // all the merged streams should have the same vertex count
-        assert(vssrc->numvertices==vsnew->numvertices || vssrcitr==streams);
-
-        vsnew->indexmapping = vssrc->indexmapping;
-        if(((*offitr) + vssrc->stride) > vsnew->stride)
+        if(!memcmp(vs->buffer + table[h]*stride, vertdata, stride))
         {
-            taa_scenemesh_resize_vertices(
-                vsnew,
-                (*offitr) + vssrc->stride,
-                vssrc->numvertices);        
+            break;
         }
-        ++offitr;
-        ++vssrcitr;
+        h = (h + 1) & mask;
     }
+    return table + h;
+}
 
-    // copy the vertex data from each source stream into the merged stream
-    vssrcitr = streams;
-    vssrcend = vssrcitr + numstreams;
-    offitr = streamoffsets;
-    while(vssrcitr != vssrcend)
+//****************************************************************************
+static void taa_scenemesh_read_floats(
+    const taa_scenemesh_stream* vs,
+    uint32_t vertex,
+    float* values_out,
+    uint32_t numvalues)
+{
+    // reads the components of a vertex as floats, missing components are
+    // filled with zero
+    const uint8_t* src = vs->buffer + vs->stride*vertex;
+    uint32_t compsize = taa_scenemesh_calc_stride(vs->valuetype, 1);
+    uint32_t i;
+    for(i = 0; i < numvalues; ++i)
     {
-        uint8_t* bufitr;
-        uint8_t* bufend;
-        const uint8_t* bufsrc;
-
-        vssrc = *vssrcitr;
-        bufsrc = vssrc->buffer;
-        bufitr = vsnew->buffer + (*offitr);
-        bufend = bufitr + (vsnew->stride * vsnew->numvertices);
-        while(bufitr != bufend)
+        float f = 0.0f;
+        if(i < vs->numcomponents)
         {
-            memcpy(bufitr, bufsrc, vssrc->stride);
-            bufsrc += vssrc->stride;
-            bufitr += vsnew->stride;
+            f = (float) taa_scenemesh_decode_value(vs->valuetype, src);
+            src += compsize;
         }
-        ++offitr;
-        ++vssrcitr;
+        values_out[i] = f;
     }
+}
 
-    // add original vertex streams back into new stream set
-    newnumstreams = 1; // first stream is the newly merged stream
-    vsitr = mesh->vertexstreams;
-    vsend = vsitr + mesh->numstreams;
-    while(vsitr != vsend)
+//****************************************************************************
+static float* taa_scenemesh_read_positions(
+    const taa_scenemesh* mesh,
+    int32_t posvs)
+{
+    // reads a position stream into a packed float array, undoing any bounds
+    // quantization of the stream
+    const taa_scenemesh_stream* vs = mesh->vertexstreams + posvs;
+    const taa_scenemesh_quantization* q = NULL;
+    float* positions;
+    uint32_t i;
+    int qi = taa_scenemesh_find_quantization(mesh, vs->usage, vs->set);
+    if(qi >= 0 && mesh->quantizations[qi].quantize ==
+       taa_SCENEMESH_QUANTIZE_BOUNDS)
     {
-        vssrcitr = streams;
-        vssrcend = vssrcitr + numstreams;
-        while(vssrcitr != vssrcend)
-        {
-            if(*vssrcitr == vsitr)
-            {
-                // this stream is one of the merged streams
-                break;
-            }
-            ++vssrcitr;
-        }
-        if(vssrcitr == vssrcend)
+        q = mesh->quantizations + qi;
+    }
+    positions = (float*) malloc(vs->numvertices * 3 * sizeof(*positions));
+    for(i = 0; i < vs->numvertices; ++i)
+    {
+        float* p = positions + i*3;
+        taa_scenemesh_read_floats(vs, i, p, 3);
+        if(q != NULL)
         {
-            // the stream was not merged, add it to the new stream set
-            ++newnumstreams;
-            vsnew = (taa_scenemesh_stream*) realloc(
-                vsnew,
-                sizeof(*vsnew) * newnumstreams);
-            vsnew[newnumstreams-1] = *vsitr;
+            p[0] = q->bias[0] + q->scale[0]*p[0];
+            p[1] = q->bias[1] + q->scale[1]*p[1];
+            p[2] = q->bias[2] + q->scale[2]*p[2];
         }
-        ++vsitr;
     }
-    assert(newnumstreams==(mesh->numstreams-numstreams)+1);
+    return positions;
+}
 
-    // clean up the source streams
-    vssrcitr = streams;
-    vssrcend = vssrcitr + numstreams;
-    while(vssrcitr != vssrcend)
+//****************************************************************************
+static void taa_scenemesh_read_vector(
+    const taa_scenemesh_stream* vs,
+    const taa_scenemesh_quantization* q,
+    uint32_t vertex,
+    float* v_out)
+{
+    // reads the first 3 components of a vertex as floats, undoing any
+    // quantization of the stream
+    if(q != NULL && q->quantize == taa_SCENEMESH_QUANTIZE_OCTAHEDRAL)
     {
-        vssrc = *vssrcitr;
-        taa_memalign_free(vssrc->buffer);
-        ++vssrcitr;
+        float uv[2];
+        taa_scenemesh_read_floats(vs, vertex, uv, 2);
+        taa_scenemesh_decode_octahedral(uv[0], uv[1], v_out);
+    }
+    else if(vs->valuetype == taa_SCENEMESH_VALUE_FLOAT32 &&
+            vs->numcomponents >= 3)
+    {
+        memcpy(v_out, vs->buffer + vs->stride*vertex, 3 * sizeof(*v_out));
+    }
+    else
+    {
+        taa_scenemesh_read_floats(vs, vertex, v_out, 3);
+    }
+    if(q != NULL && q->quantize == taa_SCENEMESH_QUANTIZE_BOUNDS)
+    {
+        v_out[0] = q->bias[0] + q->scale[0]*v_out[0];
+        v_out[1] = q->bias[1] + q->scale[1]*v_out[1];
+        v_out[2] = q->bias[2] + q->scale[2]*v_out[2];
     }
-    free(mesh->vertexstreams);
-
-    mesh->vertexstreams = vsnew;
-    mesh->numstreams = newnumstreams;
-    return 0; // new stream is first
 }
 
 //****************************************************************************
-void taa_scenemesh_remove_stream(
-    taa_scenemesh* mesh,
+static void taa_scenemesh_rehash_vertices(
     taa_scenemesh_stream* vs)
 {
-    uint32_t i;
-    uint32_t iend;
-    uint32_t removeoffset;
-    taa_scenemesh_stream* vsitr;
-    taa_scenemesh_stream* vsend;
-
-    removeoffset = 1; // true
-    vsitr = mesh->vertexstreams;
-    vsend = vsitr + mesh->numstreams;
-    while(vsitr != vsend)
+    uint32_t size = 16;
+    const uint8_t* vitr;
+    const uint8_t* vend;
+    while(size < vs->numvertices * 2)
     {
-        if((vsitr != vs) && vsitr->indexmapping == vs->indexmapping)
+        size <<= 1;
+    }
+    if(size != vs->vertexhashsize)
+    {
+        free(vs->vertexhash);
+        vs->vertexhash = (uint32_t*) malloc(size * sizeof(*vs->vertexhash));
+        vs->vertexhashsize = size;
+    }
+    memset(vs->vertexhash, 0xff, size * sizeof(*vs->vertexhash));
+    // insert in order so that duplicates resolve to the first occurrence
+    vitr = vs->buffer;
+    vend = vitr + vs->stride * vs->numvertices;
+    while(vitr != vend)
+    {
+        uint32_t* slot = taa_scenemesh_probe_vertexhash(vs, vitr);
+        if(*slot == ~0U)
         {
-            // the indices are shared with another vertex stream
-            removeoffset = 0; // false
-            break;
+            *slot = (uint32_t) ((vitr - vs->buffer) / vs->stride);
         }
-        ++vsitr;
+        vitr += vs->stride;
     }
+}
 
-    if(removeoffset)
+//****************************************************************************
+static void taa_scenemesh_rotate_bounds(
+    taa_scenemesh_bounds* bounds,
+    int32_t dir)
+{
+    // applies the same rotation as taa_scenemesh_rotate_upaxis. the box
+    // stays exact since the rotation only swaps and negates axes.
+    float miny = bounds->min[1];
+    float maxy = bounds->max[1];
+    float cy = bounds->center[1];
+    if(dir > 0)
     {
-        taa_scenemesh_face* faceitr;
-        taa_scenemesh_face* faceend;
-        uint32_t* indexitr;
+        bounds->min[1] = bounds->min[2];
+        bounds->max[1] = bounds->max[2];
+        bounds->min[2] = -maxy;
+        bounds->max[2] = -miny;
+    }
+    else
+    {
+        bounds->min[1] = -bounds->max[2];
+        bounds->max[1] = -bounds->min[2];
+        bounds->min[2] = miny;
+        bounds->max[2] = maxy;
+    }
+    bounds->center[1] = dir * bounds->center[2];
+    bounds->center[2] = dir * -cy;
+}
 
-        // remove indices from index buffer and all the faces
-        removeoffset = vs->indexmapping;
-        iend = mesh->indexsize--;
-        faceitr = mesh->faces;
-        faceend = faceitr + mesh->numfaces;
-        indexitr = mesh->indices;
-        while(faceitr != faceend)
+#ifdef taa_SCENEMESH_SSE
+//****************************************************************************
+static uint32_t taa_scenemesh_rotate_f32(
+    float* vbuf,
+    uint32_t numvertices,
+    uint32_t stride,
+    int32_t dir)
+{
+    // swaps y and z, then negates one of them by flipping its sign bit.
+    // returns the number of vertices rotated.
+    float y = (dir < 0) ? -0.0f : 0.0f;
+    float z = (dir < 0) ? 0.0f : -0.0f;
+    __m128 sign = _mm_set_ps(0.0f, 0.0f, z, y);
+    float* vitr = vbuf;
+    uint32_t i = 0;
+    if(stride == 3)
+    {
+        // packed vectors, 4 at a time in 3 registers
+        __m128 signa = _mm_set_ps(0.0f, z, y, 0.0f);
+        __m128 signb = _mm_set_ps(y, 0.0f, z, y);
+        __m128 signc = _mm_set_ps(z, y, 0.0f, z);
+        for(; i + 4 <= numvertices; i += 4)
         {
-            const uint32_t* indexsrc;
-            const uint32_t* indexsrcend;
-            uint32_t* indexoff;
+            __m128 a = _mm_loadu_ps(vitr);
+            __m128 b = _mm_loadu_ps(vitr + 4);
+            __m128 c = _mm_loadu_ps(vitr + 8);
+            __m128 t = _mm_shuffle_ps(b, c, _MM_SHUFFLE(0, 0, 2, 2));
+            __m128 u = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 3, 3));
+            a = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 2, 0));
+            b = _mm_shuffle_ps(b, t, _MM_SHUFFLE(2, 0, 0, 1));
+            c = _mm_shuffle_ps(u, c, _MM_SHUFFLE(2, 3, 2, 0));
+            _mm_storeu_ps(vitr, _mm_xor_ps(a, signa));
+            _mm_storeu_ps(vitr + 4, _mm_xor_ps(b, signb));
+            _mm_storeu_ps(vitr + 8, _mm_xor_ps(c, signc));
+            vitr += 12;
+        }
+    }
+    for(; i < numvertices; ++i)
+    {
+        __m128 yz = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*) (vitr+1));
+        yz = _mm_shuffle_ps(yz, yz, _MM_SHUFFLE(3, 2, 0, 1));
+        _mm_storel_pi((__m64*) (vitr + 1), _mm_xor_ps(yz, sign));
+        vitr += stride;
+    }
+    return numvertices;
+}
+#endif
 
-            indexoff = indexitr;
-            indexsrc = mesh->indices + faceitr->firstindex;
-            indexsrcend = indexsrc + faceitr->numindices;
-            while(indexsrc != indexsrcend)
+#ifdef taa_SCENEMESH_SSE2
+//****************************************************************************
+static uint32_t taa_scenemesh_rotate_f64(
+    double* vbuf,
+    uint32_t numvertices,
+    uint32_t stride,
+    int32_t dir)
+{
+    double y = (dir < 0) ? -0.0 : 0.0;
+    double z = (dir < 0) ? 0.0 : -0.0;
+    __m128d sign = _mm_set_pd(z, y);
+    double* vitr = vbuf;
+    uint32_t i;
+    for(i = 0; i < numvertices; ++i)
+    {
+        __m128d yz = _mm_loadu_pd(vitr + 1);
+        yz = _mm_shuffle_pd(yz, yz, 1);
+        _mm_storeu_pd(vitr + 1, _mm_xor_pd(yz, sign));
+        vitr += stride;
+    }
+    return numvertices;
+}
+
+//****************************************************************************
+static uint32_t taa_scenemesh_rotate_i16x4(
+    uint16_t* vbuf,
+    uint32_t numvertices,
+    uint32_t stride,
+    int32_t dir,
+    int ishalf)
+{
+    // rotates packed 4 component vectors of 16 bit values, 2 at a time.
+    // half floats are negated by flipping the sign bit, integers by a
+    // saturating subtract from zero. returns the number of vertices rotated.
+    short neg = (short) (ishalf ? 0x8000 : 0xffff);
+    short y = (short) ((dir < 0) ? neg : 0);
+    short z = (short) ((dir < 0) ? 0 : neg);
+    __m128i negmask = _mm_set_epi16(0, z, y, 0, 0, z, y, 0);
+    uint16_t* vitr = vbuf;
+    uint32_t i = 0;
+    if(stride == 4)
+    {
+        for(; i + 2 <= numvertices; i += 2)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*) vitr);
+            v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 1, 2, 0));
+            v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(3, 1, 2, 0));
+            if(ishalf)
             {
-                for(i = 0; i != iend; ++i)
-                {
-                    if(i != removeoffset)
-                    {
-                        *indexitr = *indexsrc;
-                        ++indexitr;
-                    }
-                    ++indexsrc;
-                }
+                v = _mm_xor_si128(v, negmask);
             }
-            faceitr->firstindex = (uint32_t) (indexoff - mesh->indices);
-            faceitr->numindices = (uint32_t) (indexitr - indexoff);
-            assert(faceitr->numindices ==
-                   faceitr->numvertices * mesh->indexsize);
-            ++faceitr;
+            else
+            {
+                __m128i n = _mm_subs_epi16(_mm_setzero_si128(), v);
+                v = _mm_or_si128(
+                    _mm_andnot_si128(negmask, v),
+                    _mm_and_si128(negmask, n));
+            }
+            _mm_storeu_si128((__m128i*) vitr, v);
+            vitr += 8;
         }
+    }
+    return i;
+}
+#endif
 
-        // fix offsets of any affected vertex streams
-        vsitr = mesh->vertexstreams;
-        vsend = vsitr + mesh->numstreams;
-        while(vsitr != vsend)
+//****************************************************************************
+static void taa_scenemesh_rotate_quantized(
+    taa_scenemesh_stream* vs,
+    taa_scenemesh_quantization* q,
+    int32_t dir)
+{
+    uint32_t compsize = taa_scenemesh_calc_stride(vs->valuetype, 1);
+    uint8_t* vitr = vs->buffer;
+    uint8_t* vend = vitr + vs->stride * vs->numvertices;
+    if(q->quantize == taa_SCENEMESH_QUANTIZE_BOUNDS)
+    {
+        // swap the stored y and z values, then fold the rotation into the
+        // decode parameters so no precision is lost re-encoding
+        float fdir = (float) dir;
+        float scaley = q->scale[1];
+        float biasy = q->bias[1];
+        uint8_t tmp[8];
+        if(vs->numcomponents >= 3)
         {
-            if(removeoffset != 0 && vsitr->indexmapping > removeoffset)
+            while(vitr != vend)
             {
-                --vsitr->indexmapping;
+                memcpy(tmp, vitr + compsize, compsize);
+                memcpy(vitr + compsize, vitr + 2*compsize, compsize);
+                memcpy(vitr + 2*compsize, tmp, compsize);
+                vitr += vs->stride;
             }
-            ++vsitr;
+            q->scale[1] = fdir * q->scale[2];
+            q->bias[1] = fdir * q->bias[2];
+            q->scale[2] = fdir * -scaley;
+            q->bias[2] = fdir * -biasy;
         }
-        mesh->numindices = (uint32_t) (indexitr - mesh->indices);
     }
-    // clean up the vertex stream and remove from array
-    taa_memalign_free(vs->buffer);
-    --mesh->numstreams;
-    vsitr = vs;
-    vsend = mesh->vertexstreams + mesh->numstreams;
-    while(vsitr != vsend)
+    else if(q->quantize == taa_SCENEMESH_QUANTIZE_OCTAHEDRAL)
     {
-        *vsitr = *(vsitr + 1);
-        ++vsitr;
+        // decode, rotate and encode each vector
+        while(vitr != vend)
+        {
+            float u;
+            float v;
+            float n[3];
+            float tmp;
+            u = (float) taa_scenemesh_decode_value(vs->valuetype, vitr);
+            v = (float) taa_scenemesh_decode_value(
+                vs->valuetype,
+                vitr + compsize);
+            taa_scenemesh_decode_octahedral(u, v, n);
+            tmp = n[1];
+            n[1] = dir * n[2];
+            n[2] = dir * -tmp;
+            taa_scenemesh_encode_octahedral(n, vs->valuetype, vitr);
+            vitr += vs->stride;
+        }
     }
 }
 
 //****************************************************************************
-void taa_scenemesh_resize_bindings(
+static void taa_scenemesh_scatter_tris(
     taa_scenemesh* mesh,
-    uint32_t numbindings)
+    const taa_scenemesh_binding* binding,
+    const uint32_t* tris,
+    const uint32_t* order)
 {
-    uint32_t oldnum = mesh->numbindings;
-    taa_scenemesh_binding* binding = mesh->bindings;
-    if(numbindings > oldnum)
+    // writes packed triangles back to a binding in a new order. the face
+    // records keep their index ranges so only the index contents change.
+    const taa_scenemesh_face* faceitr = mesh->faces + binding->firstface;
+    const taa_scenemesh_face* faceend = faceitr + binding->numfaces;
+    while(faceitr != faceend)
     {
-        uint32_t cap = (oldnum     +7) & ~7;
-        uint32_t ncap= (numbindings+7) & ~7;
-        if(cap != ncap)
+        const uint32_t* t = tris + (*order)*3;
+        uint32_t* dst = mesh->indices + faceitr->firstindex;
+        dst[0] = t[0];
+        dst[1] = t[1];
+        dst[2] = t[2];
+        ++faceitr;
+        ++order;
+    }
+}
+
+//****************************************************************************
+static void taa_scenemesh_shrink_stream(
+    taa_scenemesh_stream* vs)
+{
+    size_t size = ((size_t) vs->stride) * vs->numvertices;
+    size = (size + 15) & ~((size_t) 15);
+    if(size < vs->capacity)
+    {
+        uint8_t* buf = NULL;
+        if(size > 0)
         {
-            binding = (taa_scenemesh_binding*) realloc(
-                binding,
-                ncap * sizeof(*binding));
-            mesh->bindings = binding;
+            buf = (uint8_t*) taa_scenemesh_aligned_realloc(
+                vs->buffer,
+                16,
+                size,
+                size);
         }
-        binding += oldnum;
-        memset(binding, 0, (numbindings-oldnum) * sizeof(*binding));
+        else
+        {
+            taa_memalign_free(vs->buffer);
+        }
+        vs->buffer = buf;
+        vs->capacity = size;
     }
-    mesh->numbindings = numbindings;
 }
 
 //****************************************************************************
-void taa_scenemesh_resize_faces(
-    taa_scenemesh* mesh,
-    uint32_t numfaces)
+static void taa_scenemesh_skin_vertex(
+    const taa_mat44* palette,
+    const uint32_t* joints,
+    const float* weights,
+    uint32_t numinfluences,
+    const float* p,
+    const float* n,
+    float* p_out,
+    float* n_out)
 {
-    uint32_t oldnum = mesh->numfaces;
-    taa_scenemesh_face* face = mesh->faces;
-    if(numfaces > oldnum)
+    // blends the joint matrices by weight, then transforms the position
+    // and the normal by the blended matrix. n and n_out may be NULL.
+    uint32_t i;
+#ifdef taa_SCENEMESH_SSE
+    __m128 c[4];
+    __m128 r;
+    float tmp[4];
+#if defined(taa_SCENEMESH_AVX)
+    // two columns per register
+    __m256 xy = _mm256_setzero_ps();
+    __m256 zw = _mm256_setzero_ps();
+    for(i = 0; i < numinfluences; ++i)
     {
-        uint32_t cap = (oldnum   + 1023) & ~1023;
-        uint32_t ncap= (numfaces + 1023) & ~1023;
-        if(cap != ncap)
+        const float* m = &palette[joints[i]].x.x;
+        __m256 w = _mm256_set1_ps(weights[i]);
+        xy = _mm256_add_ps(xy, _mm256_mul_ps(w, _mm256_loadu_ps(m)));
+        zw = _mm256_add_ps(zw, _mm256_mul_ps(w, _mm256_loadu_ps(m + 8)));
+    }
+    c[0] = _mm256_castps256_ps128(xy);
+    c[1] = _mm256_extractf128_ps(xy, 1);
+    c[2] = _mm256_castps256_ps128(zw);
+    c[3] = _mm256_extractf128_ps(zw, 1);
+#else
+    c[0] = c[1] = c[2] = c[3] = _mm_setzero_ps();
+    for(i = 0; i < numinfluences; ++i)
+    {
+        const float* m = &palette[joints[i]].x.x;
+        __m128 w = _mm_set1_ps(weights[i]);
+        c[0] = _mm_add_ps(c[0], _mm_mul_ps(w, _mm_loadu_ps(m)));
+        c[1] = _mm_add_ps(c[1], _mm_mul_ps(w, _mm_loadu_ps(m + 4)));
+        c[2] = _mm_add_ps(c[2], _mm_mul_ps(w, _mm_loadu_ps(m + 8)));
+        c[3] = _mm_add_ps(c[3], _mm_mul_ps(w, _mm_loadu_ps(m + 12)));
+    }
+#endif
+    r = _mm_add_ps(c[3], _mm_mul_ps(c[0], _mm_set1_ps(p[0])));
+    r = _mm_add_ps(r, _mm_mul_ps(c[1], _mm_set1_ps(p[1])));
+    r = _mm_add_ps(r, _mm_mul_ps(c[2], _mm_set1_ps(p[2])));
+    _mm_storeu_ps(tmp, r);
+    memcpy(p_out, tmp, 3 * sizeof(*p_out));
+    if(n != NULL)
+    {
+        r = _mm_mul_ps(c[0], _mm_set1_ps(n[0]));
+        r = _mm_add_ps(r, _mm_mul_ps(c[1], _mm_set1_ps(n[1])));
+        r = _mm_add_ps(r, _mm_mul_ps(c[2], _mm_set1_ps(n[2])));
+        _mm_storeu_ps(tmp, r);
+        memcpy(n_out, tmp, 3 * sizeof(*n_out));
+    }
+#else
+    float c[16];
+    memset(c, 0, sizeof(c));
+    for(i = 0; i < numinfluences; ++i)
+    {
+        const float* m = &palette[joints[i]].x.x;
+        float w = weights[i];
+        uint32_t j;
+        for(j = 0; j < 16; ++j)
         {
-            // realloc the face buffer to nearest 1k capacity
-            face = (taa_scenemesh_face*) realloc(
-                face,
-                ncap * sizeof(*face));
-            mesh->faces = face;
+            c[j] += w * m[j];
+        }
+    }
+    for(i = 0; i < 3; ++i)
+    {
+        p_out[i] = c[12+i] + c[i]*p[0] + c[4+i]*p[1] + c[8+i]*p[2];
+    }
+    if(n != NULL)
+    {
+        for(i = 0; i < 3; ++i)
+        {
+            n_out[i] = c[i]*n[0] + c[4+i]*n[1] + c[8+i]*n[2];
+        }
+    }
+#endif
+    if(n != NULL)
+    {
+        float len = n_out[0]*n_out[0] + n_out[1]*n_out[1] + n_out[2]*n_out[2];
+        if(len > 0.0f)
+        {
+            len = 1.0f/sqrtf(len);
+            n_out[0] *= len;
+            n_out[1] *= len;
+            n_out[2] *= len;
+        }
+    }
+}
+
+//****************************************************************************
+static void taa_scenemesh_update_edges(
+    const uint32_t* tris,
+    uint32_t numtris,
+    const uint32_t* vertpos,
+    uint64_t* edgekeys,
+    uint32_t* edgecounts,
+    uint32_t edgemask)
+{
+    // counts the triangles using each edge between two positions
+    uint32_t i;
+    memset(edgekeys, 0xff, (edgemask + 1) * sizeof(*edgekeys));
+    memset(edgecounts, 0, (edgemask + 1) * sizeof(*edgecounts));
+    for(i = 0; i < numtris * 3; ++i)
+    {
+        uint32_t a = vertpos[tris[i]];
+        uint32_t b = vertpos[tris[(i % 3 == 2) ? i - 2 : i + 1]];
+        if(a != b)
+        {
+            uint32_t slot = taa_scenemesh_probe_edge(edgekeys, edgemask, a, b);
+            edgekeys[slot] = (a < b) ?
+                (((uint64_t) a) << 32) | b :
+                (((uint64_t) b) << 32) | a;
+            ++edgecounts[slot];
+        }
+    }
+}
+
+//****************************************************************************
+static uint32_t taa_scenemesh_update_fifo(
+    const uint32_t* tri,
+    uint32_t* cachetimes,
+    uint32_t* timestamp)
+{
+    // simulates a fifo post transform cache using per vertex timestamps.
+    // returns the number of cache misses for the triangle.
+    uint32_t misses = 0;
+    uint32_t i;
+    for(i = 0; i < 3; ++i)
+    {
+        uint32_t v = tri[i];
+        if(*timestamp - cachetimes[v] > taa_SCENEMESH_VCACHE_SIZE)
+        {
+            cachetimes[v] = (*timestamp)++;
+            ++misses;
+        }
+    }
+    return misses;
+}
+
+//****************************************************************************
+static uint32_t taa_scenemesh_weld_positions(
+    const float* positions,
+    uint32_t numverts,
+    uint32_t* vertpos_out,
+    float* points_out)
+{
+    // gives vertices with equal positions the same position id, using a
+    // hash of the coordinates rather than comparing every pair. The
+    // coordinates are compared by value, so -0 and +0 are the same
+    // position, as they are across the plane of a mirrored mesh. The
+    // distinct positions are written to points_out, and their number is
+    // returned.
+    uint32_t hashsize = 16;
+    uint32_t* hashtable;
+    uint32_t numpos = 0;
+    uint32_t i;
+    while(hashsize < numverts * 2)
+    {
+        hashsize <<= 1;
+    }
+    hashtable = (uint32_t*) malloc(hashsize * sizeof(*hashtable));
+    memset(hashtable, 0xff, hashsize * sizeof(*hashtable));
+    for(i = 0; i < numverts; ++i)
+    {
+        float p[3];
+        uint32_t h;
+        // adding zero turns -0 into +0, so equal values hash the same
+        p[0] = positions[i*3 + 0] + 0.0f;
+        p[1] = positions[i*3 + 1] + 0.0f;
+        p[2] = positions[i*3 + 2] + 0.0f;
+        h = taa_scenemesh_hash(p, sizeof(p)) & (hashsize - 1);
+        while(hashtable[h] != ~0U)
+        {
+            const float* q = points_out + hashtable[h]*3;
+            if(q[0] == p[0] && q[1] == p[1] && q[2] == p[2])
+            {
+                break;
+            }
+            h = (h + 1) & (hashsize - 1);
+        }
+        if(hashtable[h] == ~0U)
+        {
+            hashtable[h] = numpos;
+            memcpy(points_out + numpos*3, p, sizeof(p));
+            ++numpos;
+        }
+        vertpos_out[i] = hashtable[h];
+    }
+    free(hashtable);
+    return numpos;
+}
+
+//****************************************************************************
+static float taa_scenemesh_write_quantized(
+    taa_scenemesh_stream* vs,
+    const taa_scenemesh_quantization* q,
+    taa_scenemesh_valuetype valuetype,
+    uint32_t numcomponents)
+{
+    // encodes the stream in place with the decode parameters of q, and
+    // returns the largest error of any decoded component
+    taa_scenemesh_quantize quantize = q->quantize;
+    taa_scenemesh_stream tmpvs;
+    float maxerror = 0.0f;
+    uint32_t compsize;
+    uint32_t newstride;
+    uint32_t i;
+    uint32_t j;
+
+    compsize = taa_scenemesh_calc_stride(valuetype, 1);
+    newstride = compsize * numcomponents;
+    tmpvs = *vs;
+    tmpvs.valuetype = valuetype;
+    tmpvs.numcomponents = numcomponents;
+    tmpvs.stride = 0;
+    tmpvs.numvertices = 0;
+    tmpvs.buffer = NULL;
+    tmpvs.capacity = 0;
+    tmpvs.vertexhash = NULL;
+    tmpvs.vertexhashsize = 0;
+    taa_scenemesh_resize_vertices(&tmpvs, newstride, vs->numvertices);
+    for(i = 0; i < vs->numvertices; ++i)
+    {
+        uint8_t* dst = tmpvs.buffer + newstride*i;
+        float v[4];
+        float d[4];
+        taa_scenemesh_read_floats(vs, i, v, 4);
+        if(quantize == taa_SCENEMESH_QUANTIZE_BOUNDS)
+        {
+            for(j = 0; j < numcomponents; ++j)
+            {
+                float n = (v[j] - q->bias[j]) / q->scale[j];
+                taa_scenemesh_encode_value(valuetype, n, dst + compsize*j);
+                d[j] = (float) taa_scenemesh_decode_value(
+                    valuetype,
+                    dst + compsize*j);
+                d[j] = q->bias[j] + q->scale[j]*d[j];
+            }
+        }
+        else
+        {
+            float len = sqrtf(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+            len = (len > 0.0f) ? len : 1.0f;
+            v[0] /= len;
+            v[1] /= len;
+            v[2] /= len;
+            taa_scenemesh_encode_octahedral(v, valuetype, dst);
+            taa_scenemesh_decode_octahedral(
+                (float) taa_scenemesh_decode_value(valuetype, dst),
+                (float) taa_scenemesh_decode_value(valuetype, dst+compsize),
+                d);
+            if(numcomponents == 3)
+            {
+                // handedness is not part of the error
+                v[3] = (v[3] < 0.0f) ? -1.0f : 1.0f;
+                taa_scenemesh_encode_value(valuetype, v[3], dst+2*compsize);
+            }
+            j = 3;
+        }
+        while(j-- > 0)
+        {
+            float err = fabsf(d[j] - v[j]);
+            maxerror = (err > maxerror) ? err : maxerror;
+        }
+    }
+
+    // apply the new format to the stream
+    taa_memalign_free(vs->buffer);
+    if(vs->vertexhash != NULL)
+    {
+        free(vs->vertexhash);
+        taa_scenemesh_rehash_vertices(&tmpvs);
+    }
+    *vs = tmpvs;
+    return maxerror;
+}
+
+// single pass conversions for common vertex formats, tried by
+// taa_scenemesh_format_stream before converting component by component
+static const taa_scenemesh_formatkernel taa_scenemesh_formatkernels[] =
+{
+#define taa_FORMATKERNEL(srct, dstt, n, func) \
+    { taa_SCENEMESH_VALUE_##srct, n, taa_SCENEMESH_VALUE_##dstt, n, func }
+    taa_FORMATKERNEL(FLOAT64, FLOAT32, 1, taa_scenemesh_format_f64_f32),
+    taa_FORMATKERNEL(FLOAT64, FLOAT32, 2, taa_scenemesh_format_f64_f32),
+    taa_FORMATKERNEL(FLOAT64, FLOAT32, 3, taa_scenemesh_format_f64_f32),
+    taa_FORMATKERNEL(FLOAT64, FLOAT32, 4, taa_scenemesh_format_f64_f32),
+    taa_FORMATKERNEL(FLOAT32, FLOAT16, 1, taa_scenemesh_format_f32_f16),
+    taa_FORMATKERNEL(FLOAT32, FLOAT16, 2, taa_scenemesh_format_f32_f16),
+    taa_FORMATKERNEL(FLOAT32, FLOAT16, 3, taa_scenemesh_format_f32_f16),
+    taa_FORMATKERNEL(FLOAT32, FLOAT16, 4, taa_scenemesh_format_f32_f16),
+    taa_FORMATKERNEL(FLOAT32, SNORM16, 1, taa_scenemesh_format_f32_snorm16),
+    taa_FORMATKERNEL(FLOAT32, SNORM16, 2, taa_scenemesh_format_f32_snorm16),
+    taa_FORMATKERNEL(FLOAT32, SNORM16, 3, taa_scenemesh_format_f32_snorm16),
+    taa_FORMATKERNEL(FLOAT32, SNORM16, 4, taa_scenemesh_format_f32_snorm16),
+#undef taa_FORMATKERNEL
+    {
+        taa_SCENEMESH_VALUE_FLOAT32, 3,
+        taa_SCENEMESH_VALUE_FLOAT32, 4,
+        taa_scenemesh_format_f32x3_f32x4
+    }
+};
+
+//****************************************************************************
+taa_scenemesh_face* taa_scenemesh_add_face(
+    taa_scenemesh* mesh,
+    const uint32_t* indices,
+    uint32_t numindices,
+    uint32_t numvertices)
+{
+    int32_t faceid = mesh->numfaces;
+    int32_t firstindex = mesh->numindices;
+    taa_scenemesh_face* newface;
+    uint32_t* newindices;
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    // resize face buffer
+    taa_scenemesh_resize_faces(mesh, faceid + 1);
+    newface = mesh->faces + faceid;
+    newface->firstindex = firstindex;
+    newface->numindices = numindices;
+    newface->numvertices = numvertices;
+    // resize index buffer and copy indices
+    taa_scenemesh_resize_indices(mesh, firstindex + numindices);
+    newindices = mesh->indices + firstindex;
+    memcpy(newindices, indices, sizeof(*newindices)*numindices);
+    return newface;
+}
+
+//****************************************************************************
+int taa_scenemesh_add_skinjoint(
+    taa_scenemesh* mesh,
+    uint32_t animjoint,
+    const taa_mat44* invbindmatrix)
+{
+    uint32_t jointid = mesh->numjoints;
+    taa_scenemesh_skinjoint* joint;
+    taa_scenemesh_resize_skinjoints(mesh, jointid + 1);
+    joint = mesh->joints + jointid;
+    joint->animjoint = animjoint;
+    joint->invbindmatrix = *invbindmatrix;
+    return jointid;
+}
+
+//****************************************************************************
+int taa_scenemesh_add_stream(
+    taa_scenemesh* mesh,
+    const char* name,
+    taa_scenemesh_usage usage,
+    int set,
+    taa_scenemesh_valuetype valuetype,
+    int numcomponents,
+    int stride,
+    int indexmapping,
+    uint32_t numvertices,
+    const void* srcbuffer)
+{
+    int32_t vsid = mesh->numstreams;
+    taa_scenemesh_stream* vs;
+    size_t bufsize;
+
+    // resize vertex stream array and grab pointer to new stream
+    taa_scenemesh_resize_streams(mesh, vsid + 1);
+    vs = mesh->vertexstreams + vsid;
+
+    strncpy(vs->name, name, sizeof(vs->name));
+    vs->name[sizeof(vs->name) - 1] = '\0';
+    vs->usage = usage;
+    vs->set = set;
+    vs->valuetype = valuetype;
+    vs->numcomponents = numcomponents;
+    vs->indexmapping = indexmapping;
+    taa_scenemesh_resize_vertices(vs, stride, numvertices);
+    bufsize = ((size_t) numvertices) * stride;
+    if(bufsize == 0)
+    {
+        // an empty stream has no buffer to fill
+    }
+    else if(srcbuffer != NULL)
+    {
+        memcpy(vs->buffer, srcbuffer, bufsize);
+    }
+    else
+    {
+        memset(vs->buffer, 0, bufsize);
+    }
+
+    if(indexmapping >= mesh->indexsize)
+    {
+        mesh->indexsize = indexmapping + 1;
+    }
+
+    return vsid;
+}
+
+//****************************************************************************
+int taa_scenemesh_add_vertex(
+    taa_scenemesh_stream* vs,
+    const void* vertdata)
+{
+    int index = vs->numvertices;
+    int stride = vs->stride;
+    taa_scenemesh_resize_vertices(vs, stride, index + 1);
+    memcpy(((uint8_t*) vs->buffer) + stride*index, vertdata, stride);
+    if(vs->vertexhash != NULL)
+    {
+        if(vs->numvertices * 2 > vs->vertexhashsize)
+        {
+            // keep the load factor at or below one half
+            taa_scenemesh_rehash_vertices(vs);
+        }
+        else
+        {
+            uint32_t* slot = taa_scenemesh_probe_vertexhash(vs, vertdata);
+            if(*slot == ~0U)
+            {
+                *slot = index;
+            }
+        }
+    }
+    return index;
+}
+
+//****************************************************************************
+void taa_scenemesh_begin_binding(
+    taa_scenemesh* mesh,
+    const char* name,
+    int matid)
+{
+    int i = mesh->numbindings;
+    taa_scenemesh_binding* binding;
+    taa_scenemesh_resize_bindings(mesh, i + 1);
+    binding = mesh->bindings + i;
+    strncpy(binding->name, name, sizeof(binding->name)-1);
+    binding->materialid = matid;
+    binding->firstface = mesh->numfaces;
+    binding->numfaces = 0;
+}
+
+//****************************************************************************
+void taa_scenemesh_build_depth(
+    taa_scenemesh* mesh)
+{
+    taa_scenemesh_stream* ds = &mesh->depthstream;
+    int posstream;
+    assert(mesh->indexsize == 1); // must be merged
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    // discard any previous depth geometry
+    taa_scenemesh_resize_depthindices(mesh, 0);
+    taa_scenemesh_resize_vertices(ds, ds->stride, 0);
+    posstream = taa_scenemesh_find_stream(mesh,taa_SCENEMESH_USAGE_POSITION,0);
+    if(posstream >= 0)
+    {
+        const taa_scenemesh_stream* vs = mesh->vertexstreams + posstream;
+        const uint32_t* indexitr = mesh->indices;
+        const uint32_t* indexend = indexitr + mesh->numindices;
+        uint32_t* depthitr;
+        uint32_t* remap;
+        memcpy(ds->name, vs->name, sizeof(ds->name));
+        ds->usage = vs->usage;
+        ds->set = vs->set;
+        ds->valuetype = vs->valuetype;
+        ds->numcomponents = vs->numcomponents;
+        ds->indexmapping = 0;
+        taa_scenemesh_resize_vertices(ds, vs->stride, 0);
+        taa_scenemesh_create_vertexhash(ds);
+        taa_scenemesh_resize_depthindices(mesh, mesh->numindices);
+        // add the distinct positions in order of first use, so vertices
+        // split by other attributes share a single depth vertex, and the
+        // depth vertices are fetched in roughly the same order as the mesh
+        // vertices
+        remap = (uint32_t*) malloc(vs->numvertices * sizeof(*remap));
+        memset(remap, 0xff, vs->numvertices * sizeof(*remap));
+        depthitr = mesh->depthindices;
+        while(indexitr != indexend)
+        {
+            uint32_t* r = remap + *indexitr;
+            if(*r == ~0U)
+            {
+                *r = (uint32_t) taa_scenemesh_find_or_add_vertex(
+                    ds,
+                    vs->buffer + ((size_t) vs->stride) * (*indexitr));
+            }
+            *depthitr = *r;
+            ++depthitr;
+            ++indexitr;
+        }
+        taa_scenemesh_destroy_vertexhash(ds);
+        free(remap);
+    }
+}
+
+//****************************************************************************
+void taa_scenemesh_build_meshlets(
+    taa_scenemesh* mesh,
+    uint32_t maxvertices,
+    uint32_t maxtriangles)
+{
+    int32_t posvs;
+    uint32_t numverts;
+    uint32_t* tris;
+    uint32_t* vtrifirst;
+    uint32_t* vtricount;
+    uint32_t* vtris;
+    uint32_t* vertlocal;
+    uint8_t* emitted;
+    float* positions;
+    float* normals;
+    const taa_scenemesh_binding* bindingitr;
+    const taa_scenemesh_binding* bindingend;
+    uint32_t i;
+
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    // the mesh must be triangulated with merged indices
+    assert(mesh->indexsize == 1);
+    // local indices are stored in 8 bits
+    assert(maxvertices >= 3 && maxvertices <= 256);
+    assert(maxtriangles >= 1);
+
+    mesh->nummeshlets = 0;
+    mesh->nummeshletvertices = 0;
+    mesh->nummeshletindices = 0;
+    posvs = taa_scenemesh_find_stream(mesh, taa_SCENEMESH_USAGE_POSITION, 0);
+    positions = NULL;
+    if(posvs >= 0)
+    {
+        positions = taa_scenemesh_read_positions(mesh, posvs);
+    }
+    numverts = taa_scenemesh_calc_numindexed(mesh);
+    tris = (uint32_t*) malloc(mesh->numfaces * 3 * sizeof(*tris));
+    vtrifirst = (uint32_t*) malloc(numverts * sizeof(*vtrifirst));
+    vtricount = (uint32_t*) calloc(numverts, sizeof(*vtricount));
+    vtris = (uint32_t*) malloc(mesh->numfaces * 3 * sizeof(*vtris));
+    vertlocal = (uint32_t*) malloc(numverts * sizeof(*vertlocal));
+    emitted = (uint8_t*) malloc(mesh->numfaces * sizeof(*emitted));
+    normals = (float*) malloc(maxtriangles * 3 * sizeof(*normals));
+    memset(vertlocal, 0xff, numverts * sizeof(*vertlocal));
+    memset(vtrifirst, 0xff, numverts * sizeof(*vtrifirst));
+
+    bindingitr = mesh->bindings;
+    bindingend = bindingitr + mesh->numbindings;
+    while(bindingitr != bindingend)
+    {
+        uint32_t numtris = bindingitr->numfaces;
+        uint32_t numadjacent = 0;
+        uint32_t next = 0;
+        taa_scenemesh_meshlet* meshlet = NULL;
+        taa_scenemesh_gather_tris(mesh, bindingitr, tris);
+        memset(emitted, 0, numtris * sizeof(*emitted));
+
+        // build the list of triangles using each vertex. only the vertices
+        // referenced by the binding are touched, so the cost does not grow
+        // with the vertex count of the whole mesh.
+        for(i = 0; i < numtris * 3; ++i)
+        {
+            ++vtricount[tris[i]];
+        }
+        for(i = 0; i < numtris * 3; ++i)
+        {
+            uint32_t v = tris[i];
+            if(vtrifirst[v] == ~0U)
+            {
+                vtrifirst[v] = numadjacent;
+                numadjacent += vtricount[v];
+                vtricount[v] = 0;
+            }
+        }
+        for(i = 0; i < numtris * 3; ++i)
+        {
+            uint32_t v = tris[i];
+            vtris[vtrifirst[v] + vtricount[v]++] = i / 3;
+        }
+
+        while(1)
+        {
+            const uint32_t* tri;
+            uint32_t best = ~0U;
+            uint32_t bestnew = 4;
+            uint32_t nv;
+            uint32_t ni;
+            if(meshlet != NULL)
+            {
+                // prefer the connected triangle adding the fewest vertices
+                const uint32_t* mvitr;
+                const uint32_t* mvend;
+                mvitr = mesh->meshletvertices + meshlet->firstvertex;
+                mvend = mvitr + meshlet->numvertices;
+                while(mvitr != mvend)
+                {
+                    const uint32_t* titr = vtris + vtrifirst[*mvitr];
+                    const uint32_t* tend = titr + vtricount[*mvitr];
+                    while(titr != tend)
+                    {
+                        uint32_t t = *titr;
+                        if(!emitted[t])
+                        {
+                            uint32_t n = taa_scenemesh_count_new_verts(
+                                tris + t*3,
+                                vertlocal);
+                            if(n < bestnew || (n == bestnew && t < best))
+                            {
+                                best = t;
+                                bestnew = n;
+                            }
+                        }
+                        ++titr;
+                    }
+                    ++mvitr;
+                }
+            }
+            if(best == ~0U)
+            {
+                // nothing connected, continue with the next triangle
+                while(next < numtris && emitted[next])
+                {
+                    ++next;
+                }
+                if(next == numtris)
+                {
+                    // finished
+                    break;
+                }
+                best = next;
+                bestnew = taa_scenemesh_count_new_verts(
+                    tris + best*3,
+                    vertlocal);
+            }
+            if(meshlet == NULL ||
+               meshlet->numvertices + bestnew > maxvertices ||
+               meshlet->numtriangles == maxtriangles)
+            {
+                // start a new meshlet
+                if(meshlet != NULL)
+                {
+                    taa_scenemesh_finish_meshlet(
+                        mesh,
+                        positions,
+                        normals,
+                        vertlocal,
+                        meshlet);
+                    bestnew = taa_scenemesh_count_new_verts(
+                        tris + best*3,
+                        vertlocal);
+                }
+                taa_scenemesh_resize_meshlets(
+                    mesh,
+                    mesh->nummeshlets + 1,
+                    mesh->nummeshletvertices,
+                    mesh->nummeshletindices);
+                meshlet = mesh->meshlets + (mesh->nummeshlets - 1);
+                meshlet->binding = (uint32_t) (bindingitr - mesh->bindings);
+                meshlet->firstvertex = mesh->nummeshletvertices;
+                meshlet->firstindex = mesh->nummeshletindices;
+            }
+            // add the triangle to the meshlet
+            nv = mesh->nummeshletvertices;
+            ni = mesh->nummeshletindices;
+            taa_scenemesh_resize_meshlets(
+                mesh,
+                mesh->nummeshlets,
+                nv + bestnew,
+                ni + 3);
+            meshlet = mesh->meshlets + (mesh->nummeshlets - 1);
+            tri = tris + best*3;
+            for(i = 0; i < 3; ++i)
+            {
+                uint32_t v = tri[i];
+                if(vertlocal[v] == ~0U)
+                {
+                    vertlocal[v] = meshlet->numvertices++;
+                    mesh->meshletvertices[nv++] = v;
+                }
+                mesh->meshletindices[ni++] = (uint8_t) vertlocal[v];
+            }
+            ++meshlet->numtriangles;
+            emitted[best] = 1;
+        }
+        if(meshlet != NULL)
+        {
+            taa_scenemesh_finish_meshlet(
+                mesh,
+                positions,
+                normals,
+                vertlocal,
+                meshlet);
+        }
+        // reset the adjacency of the binding's vertices for the next one
+        for(i = 0; i < numtris * 3; ++i)
+        {
+            vtrifirst[tris[i]] = ~0U;
+            vtricount[tris[i]] = 0;
+        }
+        ++bindingitr;
+    }
+    free(normals);
+    free(emitted);
+    free(vertlocal);
+    free(vtris);
+    free(vtricount);
+    free(vtrifirst);
+    free(tris);
+    free(positions);
+}
+
+//****************************************************************************
+void taa_scenemesh_builder_add_face(
+    taa_scenemesh_builder* builder,
+    const uint32_t* indices,
+    uint32_t numvertices)
+{
+    taa_scenemesh_builder_add_faces(builder, indices, &numvertices, 1);
+}
+
+//****************************************************************************
+void taa_scenemesh_builder_add_faces(
+    taa_scenemesh_builder* builder,
+    const uint32_t* indices,
+    const uint32_t* facesizes,
+    uint32_t numfaces)
+{
+    uint32_t indexsize = builder->mesh->indexsize;
+    uint32_t firstindex = builder->mesh->numindices + builder->numindices;
+    uint32_t numindices = 0;
+    taa_scenemesh_face* faces;
+    uint32_t i;
+    faces = (taa_scenemesh_face*) taa_scenemesh_alloc_arena(
+        &builder->faces,
+        numfaces * sizeof(*faces));
+    for(i = 0; i < numfaces; ++i)
+    {
+        faces[i].firstindex = firstindex + numindices;
+        faces[i].numindices = facesizes[i] * indexsize;
+        faces[i].numvertices = facesizes[i];
+        numindices += faces[i].numindices;
+    }
+    memcpy(
+        taa_scenemesh_alloc_arena(
+            &builder->indices,
+            numindices * sizeof(*indices)),
+        indices,
+        numindices * sizeof(*indices));
+    builder->numfaces += numfaces;
+    builder->numindices += numindices;
+}
+
+//****************************************************************************
+uint32_t taa_scenemesh_builder_add_vertices(
+    taa_scenemesh_builder* builder,
+    uint32_t stream,
+    const void* vertdata,
+    uint32_t numverts)
+{
+    const taa_scenemesh_stream* vs = builder->mesh->vertexstreams + stream;
+    taa_scenemesh_arena* arena = builder->vertices + stream;
+    size_t size = ((size_t) vs->stride) * numverts;
+    uint32_t first = vs->numvertices + (uint32_t) (arena->size / vs->stride);
+    assert(stream < builder->numstreams);
+    memcpy(taa_scenemesh_alloc_arena(arena, size), vertdata, size);
+    return first;
+}
+
+//****************************************************************************
+void taa_scenemesh_builder_begin_binding(
+    taa_scenemesh_builder* builder,
+    const char* name,
+    int matid)
+{
+    taa_scenemesh* mesh = builder->mesh;
+    taa_scenemesh_begin_binding(mesh, name, matid);
+    mesh->bindings[mesh->numbindings - 1].firstface += builder->numfaces;
+}
+
+//****************************************************************************
+void taa_scenemesh_builder_create(
+    taa_scenemesh* mesh,
+    taa_scenemesh_builder* builder_out)
+{
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    memset(builder_out, 0, sizeof(*builder_out));
+    builder_out->mesh = mesh;
+    builder_out->numstreams = mesh->numstreams;
+    builder_out->vertices = (taa_scenemesh_arena*) calloc(
+        mesh->numstreams + 1,
+        sizeof(*builder_out->vertices));
+}
+
+//****************************************************************************
+void taa_scenemesh_builder_destroy(
+    taa_scenemesh_builder* builder)
+{
+    uint32_t i;
+    for(i = 0; i < builder->numstreams; ++i)
+    {
+        taa_scenemesh_free_arena(builder->vertices + i);
+    }
+    taa_scenemesh_free_arena(&builder->indices);
+    taa_scenemesh_free_arena(&builder->faces);
+    free(builder->vertices);
+}
+
+//****************************************************************************
+void taa_scenemesh_builder_end_binding(
+    taa_scenemesh_builder* builder)
+{
+    taa_scenemesh* mesh = builder->mesh;
+    taa_scenemesh_binding* binding;
+    binding = mesh->bindings + (mesh->numbindings - 1);
+    binding->numfaces = mesh->numfaces + builder->numfaces;
+    binding->numfaces -= binding->firstface;
+}
+
+//****************************************************************************
+void taa_scenemesh_builder_finalize(
+    taa_scenemesh_builder* builder)
+{
+    taa_scenemesh* mesh = builder->mesh;
+    uint32_t oldfaces = mesh->numfaces;
+    uint32_t oldindices = mesh->numindices;
+    uint32_t i;
+    assert(mesh->numstreams == builder->numstreams);
+    // each buffer is resized once, then filled from the chunks
+    taa_scenemesh_resize_faces(mesh, oldfaces + builder->numfaces);
+    taa_scenemesh_copy_arena(&builder->faces, mesh->faces + oldfaces);
+    taa_scenemesh_resize_indices(mesh, oldindices + builder->numindices);
+    taa_scenemesh_copy_arena(&builder->indices, mesh->indices + oldindices);
+    for(i = 0; i < builder->numstreams; ++i)
+    {
+        taa_scenemesh_stream* vs = mesh->vertexstreams + i;
+        taa_scenemesh_arena* arena = builder->vertices + i;
+        uint32_t oldverts = vs->numvertices;
+        if(arena->size > 0)
+        {
+            uint32_t numverts = oldverts + (uint32_t)(arena->size/vs->stride);
+            taa_scenemesh_reserve_vertices(vs, numverts);
+            taa_scenemesh_resize_vertices(vs, vs->stride, numverts);
+            taa_scenemesh_copy_arena(arena, vs->buffer + oldverts*vs->stride);
+            if(vs->vertexhash != NULL)
+            {
+                taa_scenemesh_rehash_vertices(vs);
+            }
+            taa_scenemesh_free_arena(arena);
+        }
+    }
+    taa_scenemesh_free_arena(&builder->indices);
+    taa_scenemesh_free_arena(&builder->faces);
+    builder->numfaces = 0;
+    builder->numindices = 0;
+}
+
+//****************************************************************************
+void taa_scenemesh_calc_bounds(
+    taa_scenemesh* mesh)
+{
+    int32_t posvs;
+    uint32_t indexoffset;
+    uint32_t numgathered;
+    uint32_t* visited;
+    uint32_t* firstgathered;
+    float* positions;
+    float* gathered;
+    taa_scenemesh_bounds* mb = &mesh->bounds;
+    int empty = 1;
+    uint32_t i;
+
+    memset(mb, 0, sizeof(*mb));
+    for(i = 0; i < mesh->numbindings; ++i)
+    {
+        memset(&mesh->bindings[i].bounds, 0, sizeof(*mb));
+    }
+    posvs = taa_scenemesh_find_stream(mesh, taa_SCENEMESH_USAGE_POSITION, 0);
+    if(posvs < 0)
+    {
+        // nothing to measure
+        return;
+    }
+    positions = taa_scenemesh_read_positions(mesh, posvs);
+    indexoffset = mesh->vertexstreams[posvs].indexmapping;
+
+    // gather the unique positions of each binding into aligned vectors
+    visited = (uint32_t*) malloc(
+        mesh->vertexstreams[posvs].numvertices * sizeof(*visited));
+    memset(
+        visited,
+        0xff,
+        mesh->vertexstreams[posvs].numvertices * sizeof(*visited));
+    firstgathered = (uint32_t*) malloc(
+        (mesh->numbindings + 1) * sizeof(*firstgathered));
+    gathered = (float*) taa_memalign(
+        16,
+        (mesh->numindices/mesh->indexsize + 1) * 4 * sizeof(*gathered));
+    numgathered = 0;
+    for(i = 0; i < mesh->numbindings; ++i)
+    {
+        const taa_scenemesh_binding* binding = mesh->bindings + i;
+        const taa_scenemesh_face* faceitr = mesh->faces + binding->firstface;
+        const taa_scenemesh_face* faceend = faceitr + binding->numfaces;
+        firstgathered[i] = numgathered;
+        while(faceitr != faceend)
+        {
+            uint32_t k;
+            for(k = 0; k < faceitr->numvertices; ++k)
+            {
+                uint32_t index = faceitr->firstindex;
+                uint32_t v;
+                index += k*mesh->indexsize + indexoffset;
+                if(mesh->indexwidth == sizeof(uint16_t))
+                {
+                    v = ((const uint16_t*) mesh->indices)[index];
+                }
+                else
+                {
+                    v = mesh->indices[index];
+                }
+                if(visited[v] != i)
+                {
+                    float* dst = gathered + numgathered*4;
+                    visited[v] = i;
+                    memcpy(dst, positions + v*3, 3 * sizeof(*dst));
+                    dst[3] = 0.0f;
+                    ++numgathered;
+                }
+            }
+            ++faceitr;
+        }
+    }
+    firstgathered[mesh->numbindings] = numgathered;
+
+    // boxes of each binding, and their union for the mesh
+    for(i = 0; i < mesh->numbindings; ++i)
+    {
+        taa_scenemesh_bounds* bb = &mesh->bindings[i].bounds;
+        uint32_t first = firstgathered[i];
+        uint32_t n = firstgathered[i + 1] - first;
+        uint32_t j;
+        if(n > 0)
+        {
+            taa_scenemesh_calc_aabb(gathered + first*4, n, bb->min, bb->max);
+            for(j = 0; j < 3; ++j)
+            {
+                bb->center[j] = (bb->min[j] + bb->max[j]) * 0.5f;
+                if(empty || bb->min[j] < mb->min[j]) mb->min[j] = bb->min[j];
+                if(empty || bb->max[j] > mb->max[j]) mb->max[j] = bb->max[j];
+            }
+            empty = 0;
+        }
+    }
+    mb->center[0] = (mb->min[0] + mb->max[0]) * 0.5f;
+    mb->center[1] = (mb->min[1] + mb->max[1]) * 0.5f;
+    mb->center[2] = (mb->min[2] + mb->max[2]) * 0.5f;
+
+    // spheres around the box centers of each binding and the mesh
+    for(i = 0; i < mesh->numbindings; ++i)
+    {
+        taa_scenemesh_bounds* bb = &mesh->bindings[i].bounds;
+        uint32_t first = firstgathered[i];
+        float radii[2];
+        taa_scenemesh_calc_sphere_radii(
+            gathered + first*4,
+            firstgathered[i + 1] - first,
+            bb->center,
+            mb->center,
+            radii);
+        bb->radius = radii[0];
+        mb->radius = (radii[1] > mb->radius) ? radii[1] : mb->radius;
+    }
+    taa_memalign_free(gathered);
+    free(firstgathered);
+    free(visited);
+    free(positions);
+}
+
+//****************************************************************************
+void taa_scenemesh_calc_skinpalette(
+    const taa_scenemesh* mesh,
+    const taa_mat44* pose,
+    taa_mat44* palette_out)
+{
+    const taa_scenemesh_skinjoint* jointitr = mesh->joints;
+    const taa_scenemesh_skinjoint* jointend = jointitr + mesh->numjoints;
+    taa_mat44* paletteitr = palette_out;
+    while(jointitr != jointend)
+    {
+        taa_mat44_multiply(
+            pose + jointitr->animjoint,
+            &jointitr->invbindmatrix,
+            paletteitr);
+        ++paletteitr;
+        ++jointitr;
+    }
+}
+
+//****************************************************************************
+void taa_scenemesh_create(
+    const char* name,
+    taa_scenemesh* mesh_out)
+{
+    memset(mesh_out, 0, sizeof(*mesh_out));
+    if(name != NULL)
+    {
+        strncpy(mesh_out->name, name, sizeof(mesh_out->name));
+        mesh_out->name[sizeof(mesh_out->name)-1] = '\0';
+    }
+    mesh_out->skeleton = -1;
+    mesh_out->indexwidth = sizeof(*mesh_out->indices);
+}
+
+//****************************************************************************
+void taa_scenemesh_create_vertexhash(
+    taa_scenemesh_stream* vs)
+{
+    taa_scenemesh_rehash_vertices(vs);
+}
+
+//****************************************************************************
+void taa_scenemesh_destroy(
+    taa_scenemesh* mesh)
+{
+    taa_scenemesh_stream* vsitr = mesh->vertexstreams;
+    taa_scenemesh_stream* vsend = vsitr + mesh->numstreams;
+    // free aligned allocations
+    while(vsitr != vsend)
+    {
+        taa_memalign_free(vsitr->buffer);
+        free(vsitr->vertexhash);
+        ++vsitr;
+    }
+    taa_memalign_free(mesh->depthstream.buffer);
+    free(mesh->depthstream.vertexhash);
+    taa_memalign_free(mesh->joints);
+    // free normal allocations
+    free(mesh->indices);
+    free(mesh->faces);
+    free(mesh->bindings);
+    free(mesh->vertexstreams);
+    free(mesh->quantizations);
+    free(mesh->meshlets);
+    free(mesh->meshletvertices);
+    free(mesh->meshletindices);
+    free(mesh->lods);
+    free(mesh->lodindices);
+    free(mesh->palettejoints);
+    free(mesh->depthindices);
+}
+
+//****************************************************************************
+void taa_scenemesh_destroy_vertexhash(
+    taa_scenemesh_stream* vs)
+{
+    free(vs->vertexhash);
+    vs->vertexhash = NULL;
+    vs->vertexhashsize = 0;
+}
+
+//****************************************************************************
+void taa_scenemesh_end_binding(
+    taa_scenemesh* mesh)
+{
+    taa_scenemesh_binding* binding;
+    binding = mesh->bindings + (mesh->numbindings - 1);
+    binding->numfaces = mesh->numfaces - binding->firstface;
+}
+
+//****************************************************************************
+int taa_scenemesh_find_binding(
+    taa_scenemesh* mesh,
+    const char* name)
+{
+    int result = -1;
+    taa_scenemesh_binding* bitr = mesh->bindings;
+    taa_scenemesh_binding* bend = bitr + mesh->numbindings;
+    while(bitr != bend)
+    {
+        if(!strcmp(bitr->name, name))
+        {
+            result = (int)(ptrdiff_t) (bitr - mesh->bindings);
+            break;
+        }
+        ++bitr;
+    }
+    return result;
+}
+
+//****************************************************************************
+int taa_scenemesh_find_or_add_vertex(
+    taa_scenemesh_stream* vs,
+    const void* vertdata)
+{
+    int index = taa_scenemesh_find_vertex(vs, vertdata);
+    if(index < 0)
+    {
+        index = taa_scenemesh_add_vertex(vs, vertdata);
+    }
+    return index;
+}
+
+//****************************************************************************
+int taa_scenemesh_find_quantization(
+    const taa_scenemesh* mesh,
+    taa_scenemesh_usage usage,
+    uint32_t set)
+{
+    int result = -1;
+    const taa_scenemesh_quantization* qitr = mesh->quantizations;
+    const taa_scenemesh_quantization* qend = qitr + mesh->numquantizations;
+    while(qitr != qend)
+    {
+        if(qitr->usage == usage && qitr->set == set)
+        {
+            result = (int)(ptrdiff_t) (qitr - mesh->quantizations);
+            break;
+        }
+        ++qitr;
+    }
+    return result;
+}
+
+//****************************************************************************
+int taa_scenemesh_find_stream(
+    taa_scenemesh* mesh,
+    taa_scenemesh_usage usage,
+    uint32_t set)
+{
+    int result = -1;
+    taa_scenemesh_stream* vsitr = mesh->vertexstreams;
+    taa_scenemesh_stream* vsend = vsitr + mesh->numstreams;
+    while(vsitr != vsend)
+    {
+        if(vsitr->usage == usage && vsitr->set == set)
+        {
+            result = (int)(ptrdiff_t) (vsitr - mesh->vertexstreams);
+            break;
+        }
+        ++vsitr;
+    }
+    return result;
+}
+
+//****************************************************************************
+int taa_scenemesh_find_vertex(
+    const taa_scenemesh_stream* vs,
+    const void* vertdata)
+{
+    int index = -1;
+    int stride = vs->stride;
+    if(vs->vertexhash != NULL)
+    {
+        index = (int) *taa_scenemesh_probe_vertexhash(vs, vertdata);
+    }
+    else
+    {
+        const uint8_t* vitr = vs->buffer;
+        const uint8_t* vend = vs->buffer + (stride * vs->numvertices);
+        while(vitr != vend)
+        {
+            if(!memcmp(vertdata, vitr, stride))
+            {
+                index = (int) ((ptrdiff_t) (vitr - vs->buffer))/stride;
+                break;
+            }
+            vitr += stride;
+        }
+    }
+    return index;
+}
+
+//****************************************************************************
+void taa_scenemesh_format(
+    taa_scenemesh* mesh,
+    const taa_scenemesh_vertformat* vf,
+    int numvf)
+{
+    const taa_scenemesh_vertformat* vfitr;
+    const taa_scenemesh_vertformat* vfend;
+    unsigned int i;
+    // remove unused vertex streams
+    i = 0;
+    while(i < mesh->numstreams)
+    {
+        taa_scenemesh_stream* vs = mesh->vertexstreams + i;
+        vfitr = vf;
+        vfend = vfitr + numvf;
+        while(vfitr != vfend)
+        {
+            if(vfitr->usage == vs->usage && vfitr->set == vs->set)
+            {
+                break;
+            }
+            ++vfitr;
+        }
+        if(vfitr == vfend)
+        {
+            taa_scenemesh_remove_stream(mesh, vs);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    // if any of the source streams are missing, fill them in
+    vfitr = vf;
+    vfend = vfitr + numvf;
+    while(vfitr != vfend)
+    {
+        if(taa_scenemesh_find_stream(mesh,vfitr->usage,vfitr->set) < 0)
+        {
+            int indexmapping = 0;
+            int numverts = 0;
+            int vs;
+            int stride;
+            if(mesh->numstreams > 0)
+            {
+                indexmapping = mesh->vertexstreams[0].indexmapping;
+                numverts = mesh->vertexstreams[0].numvertices;                
+            }
+            stride = taa_scenemesh_calc_stride(
+                vfitr->valuetype,
+                vfitr->numcomponents);
+            vs = taa_scenemesh_add_stream(
+                mesh,
+                vfitr->name,
+                vfitr->usage,
+                vfitr->set,
+                vfitr->valuetype,
+                vfitr->numcomponents,
+                stride,
+                indexmapping,
+                numverts,
+                NULL);
+        }
+        ++vfitr;
+    }
+    assert(mesh->numstreams == numvf); // stream mismatch (should not happen)
+    if(mesh->numstreams == numvf)
+    {
+        taa_scenemesh_stream** mrgvs;
+        uint32_t* mrgoff;
+        void** streambufmap;
+        uint32_t nummrg;
+        vfitr = vf;
+        vfend = vfitr + numvf;
+        // reformat vertex streams
+        while(vfitr != vfend)
+        {
+            int32_t vs;
+            taa_scenemesh_stream* pvs;
+            vs = taa_scenemesh_find_stream(mesh, vfitr->usage, vfitr->set);
+            pvs = mesh->vertexstreams + vs;
+            assert(vs >= 0); // already should have filtered this case
+            if(vfitr->quantize != taa_SCENEMESH_QUANTIZE_NONE)
+            {
+                taa_scenemesh_quantize_stream(
+                    mesh,
+                    pvs,
+                    vfitr->quantize,
+                    vfitr->valuetype,
+                    vfitr->numcomponents);
+            }
+            else
+            {
+                taa_scenemesh_format_stream(
+                    pvs,
+                    vfitr->valuetype,
+                    vfitr->numcomponents);
+            }
+            ++vfitr;
+        }
+        // convert vertices to a common set of indices
+        taa_scenemesh_merge_indices(mesh);
+        // merge streams together
+        mrgvs = (taa_scenemesh_stream**) malloc(numvf * sizeof(*mrgvs));
+        mrgoff = (uint32_t*) malloc(numvf * sizeof(*mrgoff));
+        streambufmap = (void**) malloc(numvf * sizeof(*streambufmap));
+        memset(mrgvs, 0, numvf * sizeof(*mrgvs));
+        memset(mrgoff, 0, numvf * sizeof(*mrgoff));
+        memset(streambufmap, 0, numvf * sizeof(*streambufmap));
+        i = 0;
+        do
+        {
+            const char* mrgname = "";
+            taa_scenemesh_stream* pvs;
+            nummrg = 0;
+            vfitr = vf;
+            while(vfitr != vfend)
+            {
+                if(vfitr->stream == i)
+                {
+                    int32_t vs;
+                    vs = taa_scenemesh_find_stream(
+                        mesh,
+                        vfitr->usage,
+                        vfitr->set);
+                    assert(vs >= 0); // already should have filtered this case
+                    pvs = mesh->vertexstreams + vs;
+                    mrgname = (vfitr->name != NULL) ? vfitr->name : "";
+                    mrgvs[nummrg] = pvs;
+                    mrgoff[nummrg] = vfitr->offset;
+                    ++nummrg;
+                }
+                ++vfitr;
+            }
+            if(nummrg == 0)
+            {
+                // finished
+                break;
+            }
+            else if(nummrg == 1)
+            {
+                // nothing to merge
+                pvs = mrgvs[0];
+                strncpy(pvs->name, mrgname, sizeof(pvs->name));
+                pvs->name[sizeof(pvs->name)-1] = '\0';
+            }
+            else
+            {
+                uint32_t vs;
+                vs = taa_scenemesh_merge_streams(
+                    mesh,
+                    mrgname,
+                    mrgvs,
+                    mrgoff,
+                    nummrg);
+                pvs = mesh->vertexstreams + vs;
+            }
+            streambufmap[i] = pvs->buffer;
+            ++i;
+        }
+        while(1);
+        assert(i == mesh->numstreams);
+
+        // reorder streams
+        for(i = 0; i < mesh->numstreams; ++i)
+        {
+            void* bufmapping = streambufmap[i];
+            taa_scenemesh_stream vsbak = mesh->vertexstreams[i];
+            taa_scenemesh_stream* vsitr = mesh->vertexstreams;
+            while(vsitr->buffer != bufmapping)
+            {
+                assert(vsitr < mesh->vertexstreams+mesh->numstreams);
+                ++vsitr;
+            }
+            // swap
+            mesh->vertexstreams[i] = *vsitr;
+            *vsitr = vsbak;
+        }
+        free(streambufmap);
+        free(mrgoff);
+        free(mrgvs);
+    }
+}
+
+//****************************************************************************
+void taa_scenemesh_format_stream(
+    taa_scenemesh_stream* vs,
+    taa_scenemesh_valuetype valuetype,
+    unsigned int numcomponents)
+{
+    unsigned int i;
+    int srccomponentsize;
+    int newcomponentsize;
+    int newstride;
+    int srcstride;
+    uint64_t srczero;
+    uint8_t* bufitr;
+    uint8_t* bufend;
+    const uint8_t* bufsrc;
+
+    // if the source vertex stream is a merged aggregate,
+    // it cannot be reformatted
+    assert(vs->valuetype != taa_SCENEMESH_VALUE_MERGED);
+
+    if(valuetype != vs->valuetype || numcomponents != vs->numcomponents)
+    {
+        taa_scenemesh_stream tmpvs;
+        const taa_scenemesh_formatkernel* kernel = NULL;
+        newstride = taa_scenemesh_calc_stride(valuetype, numcomponents);
+        if(vs->stride == (uint32_t) taa_scenemesh_calc_stride(
+            vs->valuetype,
+            vs->numcomponents))
+        {
+            // look for a kernel that converts whole vertices at once
+            const taa_scenemesh_formatkernel* kitr;
+            const taa_scenemesh_formatkernel* kend;
+            kitr = taa_scenemesh_formatkernels;
+            kend = kitr + sizeof(taa_scenemesh_formatkernels)/sizeof(*kitr);
+            while(kitr != kend)
+            {
+                if(kitr->srctype == vs->valuetype &&
+                   kitr->srccomponents == vs->numcomponents &&
+                   kitr->dsttype == valuetype &&
+                   kitr->dstcomponents == numcomponents)
+                {
+                    kernel = kitr;
+                    break;
+                }
+                ++kitr;
+            }
+        }
+        tmpvs = *vs;
+        tmpvs.valuetype = valuetype;
+        tmpvs.numcomponents = numcomponents;
+        tmpvs.stride = 0;
+        tmpvs.numvertices = 0;
+        tmpvs.buffer = NULL;
+        tmpvs.capacity = 0;
+        tmpvs.vertexhash = NULL;
+        tmpvs.vertexhashsize = 0;
+        taa_scenemesh_resize_vertices(&tmpvs, newstride, vs->numvertices);
+        bufend = tmpvs.buffer + (newstride * vs->numvertices);
+
+        if(vs->numvertices == 0)
+        {
+            // an empty stream has no buffer to convert
+        }
+        else if(kernel != NULL)
+        {
+            kernel->func(
+                vs->buffer,
+                tmpvs.buffer,
+                vs->numvertices,
+                numcomponents);
+        }
+        else
+        {
+            srczero = 0;
+            srcstride = vs->stride;
+            newcomponentsize = newstride / numcomponents;
+            srccomponentsize = vs->stride / vs->numcomponents;
+            for(i = 0; i < numcomponents; ++i)
+            {
+                bufitr = tmpvs.buffer + i*newcomponentsize;
+                bufsrc = vs->buffer + i*srccomponentsize;
+                if(i >= vs->numcomponents)
+                {
+                    // if the new vertex format has more components than
+                    // original, fill with zeroes
+                    bufsrc = (uint8_t*) &srczero;
+                    srcstride = 0;
+                }
+                if(vs->valuetype <= taa_SCENEMESH_VALUE_UINT32 &&
+                   valuetype <= taa_SCENEMESH_VALUE_UINT32)
+                {
+                    // plain C conversion between the unscaled types, which
+                    // are the enum values up to and including UINT32
+                    taa_FORMAT(
+                        vs->valuetype,
+                        valuetype,
+                        bufsrc,
+                        bufitr,
+                        bufend,
+                        srcstride,
+                        newstride)
+                }
+                else
+                {
+                    taa_scenemesh_format_values(
+                        vs->valuetype,
+                        valuetype,
+                        bufsrc,
+                        bufitr,
+                        bufend,
+                        srcstride,
+                        newstride);
+                }
+            }
+        }
+        // apply the new format to the stream
+        taa_memalign_free(vs->buffer);
+        if(vs->vertexhash != NULL)
+        {
+            free(vs->vertexhash);
+            taa_scenemesh_rehash_vertices(&tmpvs);
+        }
+        *vs = tmpvs;
+    }
+}
+
+//****************************************************************************
+void taa_scenemesh_generate_normals(
+    taa_scenemesh* mesh,
+    float creaseangle)
+{
+    int32_t posvs;
+    int32_t normvs;
+    taa_scenemesh_stream* vs;
+    uint32_t indexsize = mesh->indexsize;
+    uint32_t posmapping;
+    uint32_t numverts;
+    uint32_t numcorners;
+    float* positions;
+    float* points;
+    uint32_t* vertpos;
+    // position vertex and face of each face corner
+    uint32_t* cornervert;
+    uint32_t* cornerface;
+    float* cornerangles;
+    float* cornernormals;
+    float* facenormals;
+    // corners around each welded position
+    uint32_t* posstart;
+    uint32_t* poscorners;
+    uint32_t numpos;
+    float mincos;
+    uint32_t c;
+    uint32_t f;
+    uint32_t i;
+
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    if(taa_scenemesh_find_stream(mesh, taa_SCENEMESH_USAGE_POSITION, 0) < 0)
+    {
+        return;
+    }
+    normvs = taa_scenemesh_find_stream(mesh, taa_SCENEMESH_USAGE_NORMAL, 0);
+    if(normvs >= 0)
+    {
+        taa_scenemesh_remove_stream(mesh, mesh->vertexstreams + normvs);
+        indexsize = mesh->indexsize;
+    }
+    posvs = taa_scenemesh_find_stream(mesh, taa_SCENEMESH_USAGE_POSITION, 0);
+    posmapping = mesh->vertexstreams[posvs].indexmapping;
+    numverts = mesh->vertexstreams[posvs].numvertices;
+    numcorners = 0;
+    for(f = 0; f < mesh->numfaces; ++f)
+    {
+        numcorners += mesh->faces[f].numvertices;
+    }
+    positions = taa_scenemesh_read_positions(mesh, posvs);
+    points = (float*) malloc((numverts + 1) * 3 * sizeof(*points));
+    vertpos = (uint32_t*) malloc((numverts + 1) * sizeof(*vertpos));
+    cornervert = (uint32_t*) malloc((numcorners + 1) * sizeof(*cornervert));
+    cornerface = (uint32_t*) malloc((numcorners + 1) * sizeof(*cornerface));
+    cornerangles = (float*) malloc((numcorners + 1) * sizeof(*cornerangles));
+    cornernormals = (float*) malloc((numcorners+1)*3*sizeof(*cornernormals));
+    facenormals = (float*) malloc((mesh->numfaces+1)*3*sizeof(*facenormals));
+    numpos = taa_scenemesh_weld_positions(positions,numverts,vertpos,points);
+    posstart = (uint32_t*) calloc(numpos + 1, sizeof(*posstart));
+    poscorners = (uint32_t*) malloc((numcorners + 1) * sizeof(*poscorners));
+
+    // normal of each face by newell's method, so polygons need not be
+    // triangulated, and the angle of each face at each of its corners
+    c = 0;
+    for(f = 0; f < mesh->numfaces; ++f)
+    {
+        const taa_scenemesh_face* face = mesh->faces + f;
+        const uint32_t* indices = mesh->indices+face->firstindex+posmapping;
+        uint32_t nv = face->numvertices;
+        float* fn = facenormals + f*3;
+        float len;
+        uint32_t k;
+        fn[0] = 0.0f;
+        fn[1] = 0.0f;
+        fn[2] = 0.0f;
+        for(k = 0; k < nv; ++k)
+        {
+            uint32_t vnext = indices[((k + 1) % nv) * indexsize];
+            const float* p0 = points + vertpos[indices[k*indexsize]]*3;
+            const float* p1 = points + vertpos[vnext]*3;
+            fn[0] += (p0[1] - p1[1]) * (p0[2] + p1[2]);
+            fn[1] += (p0[2] - p1[2]) * (p0[0] + p1[0]);
+            fn[2] += (p0[0] - p1[0]) * (p0[1] + p1[1]);
+        }
+        len = sqrtf(fn[0]*fn[0] + fn[1]*fn[1] + fn[2]*fn[2]);
+        if(len > 0.0f)
+        {
+            fn[0] /= len;
+            fn[1] /= len;
+            fn[2] /= len;
+        }
+        for(k = 0; k < nv; ++k)
+        {
+            uint32_t v = indices[k*indexsize];
+            uint32_t vprev = indices[((k + nv - 1) % nv) * indexsize];
+            uint32_t vnext = indices[((k + 1) % nv) * indexsize];
+            const float* p = points + vertpos[v]*3;
+            const float* pprev = points + vertpos[vprev]*3;
+            const float* pnext = points + vertpos[vnext]*3;
+            float e0[3];
+            float e1[3];
+            float d;
+            e0[0] = pprev[0] - p[0];
+            e0[1] = pprev[1] - p[1];
+            e0[2] = pprev[2] - p[2];
+            e1[0] = pnext[0] - p[0];
+            e1[1] = pnext[1] - p[1];
+            e1[2] = pnext[2] - p[2];
+            d = sqrtf((e0[0]*e0[0] + e0[1]*e0[1] + e0[2]*e0[2]) *
+                      (e1[0]*e1[0] + e1[1]*e1[1] + e1[2]*e1[2]));
+            cornerangles[c] = 0.0f;
+            if(d > 0.0f)
+            {
+                d = (e0[0]*e1[0] + e0[1]*e1[1] + e0[2]*e1[2]) / d;
+                d = (d < -1.0f) ? -1.0f : ((d > 1.0f) ? 1.0f : d);
+                cornerangles[c] = acosf(d);
+            }
+            cornervert[c] = v;
+            cornerface[c] = f;
+            ++posstart[vertpos[v] + 1];
+            ++c;
+        }
+    }
+    // bucket the corners by welded position
+    for(i = 0; i < numpos; ++i)
+    {
+        posstart[i + 1] += posstart[i];
+    }
+    for(c = 0; c < numcorners; ++c)
+    {
+        poscorners[posstart[vertpos[cornervert[c]]]++] = c;
+    }
+    for(i = numpos; i > 0; --i)
+    {
+        posstart[i] = posstart[i - 1];
+    }
+    posstart[0] = 0;
+
+    // average the faces around each corner that are within the crease angle,
+    // weighted by their angle at the corner
+    mincos = (creaseangle < 3.14159265f) ? cosf(creaseangle) : -2.0f;
+    for(c = 0; c < numcorners; ++c)
+    {
+        const float* fn = facenormals + cornerface[c]*3;
+        uint32_t pos = vertpos[cornervert[c]];
+        float* n = cornernormals + c*3;
+        float len;
+        n[0] = 0.0f;
+        n[1] = 0.0f;
+        n[2] = 0.0f;
+        for(i = posstart[pos]; i < posstart[pos + 1]; ++i)
+        {
+            uint32_t other = poscorners[i];
+            const float* on = facenormals + cornerface[other]*3;
+            if(fn[0]*on[0] + fn[1]*on[1] + fn[2]*on[2] >= mincos)
+            {
+                float w = cornerangles[other];
+                n[0] += on[0] * w;
+                n[1] += on[1] * w;
+                n[2] += on[2] * w;
+            }
+        }
+        len = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        if(len > 0.0f)
+        {
+            n[0] /= len;
+            n[1] /= len;
+            n[2] /= len;
+        }
+        else
+        {
+            n[0] = fn[0];
+            n[1] = fn[1];
+            n[2] = fn[2];
+        }
+    }
+
+    if(indexsize > 1)
+    {
+        // the normals get an index of their own after those of each corner
+        uint32_t* oldindices;
+        uint32_t* dst;
+        normvs = taa_scenemesh_add_stream(
+            mesh,
+            "normal",
+            taa_SCENEMESH_USAGE_NORMAL,
+            0,
+            taa_SCENEMESH_VALUE_FLOAT32,
+            3,
+            3 * sizeof(float),
+            indexsize,
+            0,
+            NULL);
+        vs = mesh->vertexstreams + normvs;
+        taa_scenemesh_create_vertexhash(vs);
+        for(c = 0; c < numcorners; ++c)
+        {
+            cornervert[c] = (uint32_t) taa_scenemesh_find_or_add_vertex(
+                vs,
+                cornernormals + c*3);
+        }
+        taa_scenemesh_destroy_vertexhash(vs);
+        oldindices = (uint32_t*) malloc(
+            (mesh->numindices + 1) * sizeof(*oldindices));
+        memcpy(
+            oldindices,
+            mesh->indices,
+            mesh->numindices * sizeof(*oldindices));
+        taa_scenemesh_resize_indices(mesh, numcorners * (indexsize + 1));
+        dst = mesh->indices;
+        c = 0;
+        for(f = 0; f < mesh->numfaces; ++f)
+        {
+            taa_scenemesh_face* face = mesh->faces + f;
+            const uint32_t* src = oldindices + face->firstindex;
+            uint32_t k;
+            face->firstindex = (uint32_t) (dst - mesh->indices);
+            face->numindices = face->numvertices * (indexsize + 1);
+            for(k = 0; k < face->numvertices; ++k)
+            {
+                memcpy(dst, src, indexsize * sizeof(*dst));
+                dst[indexsize] = cornervert[c];
+                src += indexsize;
+                dst += indexsize + 1;
+                ++c;
+            }
+        }
+        free(oldindices);
+    }
+    else
+    {
+        // each vertex takes the normal of the first corner to use it, and
+        // corners across a crease get a copy of the vertex in every stream
+        uint32_t maxstride = 0;
+        uint32_t numcopies = 0;
+        uint32_t nextcap = numverts + 1;
+        uint32_t* vertnext;
+        uint8_t* vertused;
+        uint8_t* vertbuf;
+        normvs = taa_scenemesh_add_stream(
+            mesh,
+            "normal",
+            taa_SCENEMESH_USAGE_NORMAL,
+            0,
+            taa_SCENEMESH_VALUE_FLOAT32,
+            3,
+            3 * sizeof(float),
+            0,
+            numverts,
+            NULL);
+        vs = mesh->vertexstreams + normvs;
+        for(i = 0; i < mesh->numstreams; ++i)
+        {
+            if(mesh->vertexstreams[i].stride > maxstride)
+            {
+                maxstride = mesh->vertexstreams[i].stride;
+            }
+        }
+        vertnext = (uint32_t*) malloc(nextcap * sizeof(*vertnext));
+        vertused = (uint8_t*) calloc(numverts + 1, sizeof(*vertused));
+        vertbuf = (uint8_t*) malloc(maxstride + 1);
+        memset(vertnext, 0xff, nextcap * sizeof(*vertnext));
+        c = 0;
+        for(f = 0; f < mesh->numfaces; ++f)
+        {
+            const taa_scenemesh_face* face = mesh->faces + f;
+            uint32_t* indexitr = mesh->indices + face->firstindex;
+            uint32_t* indexend = indexitr + face->numindices;
+            while(indexitr != indexend)
+            {
+                const float* n = cornernormals + c*3;
+                uint32_t v = *indexitr;
+                uint32_t last = v;
+                if(!vertused[v])
+                {
+                    memcpy(vs->buffer + v*vs->stride, n, 3*sizeof(*n));
+                    vertused[v] = 1;
+                }
+                while(v != ~0U && memcmp(vs->buffer+v*vs->stride, n, 12))
+                {
+                    last = v;
+                    v = vertnext[v];
+                }
+                if(v == ~0U)
+                {
+                    v = taa_scenemesh_duplicate_vertex(mesh,*indexitr,vertbuf);
+                    memcpy(vs->buffer + v*vs->stride, n, 3*sizeof(*n));
+                    if(v >= nextcap)
+                    {
+                        nextcap *= 2;
+                        vertnext = (uint32_t*) realloc(
+                            vertnext,
+                            nextcap * sizeof(*vertnext));
+                    }
+                    vertnext[v] = ~0U;
+                    vertnext[last] = v;
+                    ++numcopies;
+                }
+                *indexitr = v;
+                ++indexitr;
+                ++c;
+            }
+        }
+        if(numcopies > 0)
+        {
+            taa_scenemesh_resize_meshlets(mesh, 0, 0, 0);
+            taa_scenemesh_resize_lods(mesh, 0, 0);
+        }
+        free(vertbuf);
+        free(vertused);
+        free(vertnext);
+    }
+    free(poscorners);
+    free(posstart);
+    free(facenormals);
+    free(cornernormals);
+    free(cornerangles);
+    free(cornerface);
+    free(cornervert);
+    free(vertpos);
+    free(points);
+    free(positions);
+}
+
+//****************************************************************************
+void taa_scenemesh_generate_tangents(
+    taa_scenemesh* mesh,
+    uint32_t texcoordset)
+{
+    int32_t posvs;
+    int32_t normvs;
+    int32_t uvvs;
+    int32_t tanvs;
+    int32_t binvs;
+    const taa_scenemesh_quantization* normq = NULL;
+    const taa_scenemesh_quantization* uvq = NULL;
+    uint32_t numverts;
+    uint32_t numcorners;
+    uint32_t hashsize;
+    uint32_t numgroups;
+    uint32_t maxstride;
+    uint32_t numcopies;
+    uint32_t nextcap;
+    float* positions;
+    float* normals;
+    float* texcoords;
+    // tangent frame group of each face corner, keyed by the position,
+    // normal, texcoord and handedness of the corner
+    uint32_t* cornergroup;
+    uint32_t* hashtable;
+    float* groupkeys;
+    // tangent and binormal of each group
+    float* groupframes;
+    uint32_t* vertnext;
+    uint8_t* vertused;
+    uint8_t* vertbuf;
+    uint32_t c;
+    uint32_t f;
+    uint32_t i;
+    int qi;
+
+    assert(mesh->indexsize == 1); // indices must be merged
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    posvs = taa_scenemesh_find_stream(mesh, taa_SCENEMESH_USAGE_POSITION, 0);
+    normvs = taa_scenemesh_find_stream(mesh, taa_SCENEMESH_USAGE_NORMAL, 0);
+    uvvs = taa_scenemesh_find_stream(
+        mesh,
+        taa_SCENEMESH_USAGE_TEXCOORD,
+        texcoordset);
+    if(posvs < 0 || normvs < 0 || uvvs < 0)
+    {
+        return;
+    }
+    // replace any existing tangent frames
+    tanvs = taa_scenemesh_find_stream(mesh, taa_SCENEMESH_USAGE_TANGENT, 0);
+    if(tanvs >= 0)
+    {
+        taa_scenemesh_remove_stream(mesh, mesh->vertexstreams + tanvs);
+    }
+    binvs = taa_scenemesh_find_stream(mesh, taa_SCENEMESH_USAGE_BINORMAL, 0);
+    if(binvs >= 0)
+    {
+        taa_scenemesh_remove_stream(mesh, mesh->vertexstreams + binvs);
+    }
+    posvs = taa_scenemesh_find_stream(mesh, taa_SCENEMESH_USAGE_POSITION, 0);
+    normvs = taa_scenemesh_find_stream(mesh, taa_SCENEMESH_USAGE_NORMAL, 0);
+    uvvs = taa_scenemesh_find_stream(
+        mesh,
+        taa_SCENEMESH_USAGE_TEXCOORD,
+        texcoordset);
+    qi = taa_scenemesh_find_quantization(mesh,taa_SCENEMESH_USAGE_NORMAL,0);
+    if(qi >= 0)
+    {
+        normq = mesh->quantizations + qi;
+    }
+    qi = taa_scenemesh_find_quantization(
+        mesh,
+        taa_SCENEMESH_USAGE_TEXCOORD,
+        texcoordset);
+    if(qi >= 0 && mesh->quantizations[qi].quantize ==
+       taa_SCENEMESH_QUANTIZE_BOUNDS)
+    {
+        uvq = mesh->quantizations + qi;
+    }
+    numverts = mesh->vertexstreams[posvs].numvertices;
+    positions = taa_scenemesh_read_positions(mesh, posvs);
+    normals = (float*) malloc((numverts + 1) * 3 * sizeof(*normals));
+    texcoords = (float*) malloc((numverts + 1) * 2 * sizeof(*texcoords));
+    for(i = 0; i < numverts; ++i)
+    {
+        float* n = normals + i*3;
+        float* uv = texcoords + i*2;
+        float len;
+        taa_scenemesh_read_vector(mesh->vertexstreams + normvs, normq, i, n);
+        len = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        if(len > 0.0f)
+        {
+            n[0] /= len;
+            n[1] /= len;
+            n[2] /= len;
+        }
+        taa_scenemesh_read_floats(mesh->vertexstreams + uvvs, i, uv, 2);
+        if(uvq != NULL)
+        {
+            uv[0] = uvq->bias[0] + uvq->scale[0]*uv[0];
+            uv[1] = uvq->bias[1] + uvq->scale[1]*uv[1];
+        }
+    }
+    numcorners = mesh->numindices;
+    hashsize = 16;
+    while(hashsize < numcorners * 2)
+    {
+        hashsize <<= 1;
+    }
+    cornergroup = (uint32_t*) malloc((numcorners + 1)*sizeof(*cornergroup));
+    hashtable = (uint32_t*) malloc(hashsize * sizeof(*hashtable));
+    groupkeys = (float*) malloc((numcorners + 1) * 9 * sizeof(*groupkeys));
+    groupframes = (float*) calloc((numcorners + 1) * 6, sizeof(*groupframes));
+    memset(cornergroup, 0xff, numcorners * sizeof(*cornergroup));
+    memset(hashtable, 0xff, hashsize * sizeof(*hashtable));
+
+    // accumulate the tangent of each triangle at each of its corners,
+    // projected onto the normal plane and weighted by the corner angle
+    numgroups = 0;
+    for(f = 0; f < mesh->numfaces; ++f)
+    {
+        const taa_scenemesh_face* face = mesh->faces + f;
+        const uint32_t* tri = mesh->indices + face->firstindex;
+        const float* p0 = positions + tri[0]*3;
+        const float* p1 = positions + tri[1]*3;
+        const float* p2 = positions + tri[2]*3;
+        const float* uv0 = texcoords + tri[0]*2;
+        const float* uv1 = texcoords + tri[1]*2;
+        const float* uv2 = texcoords + tri[2]*2;
+        float d1[3];
+        float d2[3];
+        float t[3];
+        float s1;
+        float t1;
+        float s2;
+        float t2;
+        float area;
+        float sign;
+        float len;
+        uint32_t k;
+        assert(face->numvertices == 3); // must be triangulated
+        d1[0] = p1[0] - p0[0];
+        d1[1] = p1[1] - p0[1];
+        d1[2] = p1[2] - p0[2];
+        d2[0] = p2[0] - p0[0];
+        d2[1] = p2[1] - p0[1];
+        d2[2] = p2[2] - p0[2];
+        s1 = uv1[0] - uv0[0];
+        t1 = uv1[1] - uv0[1];
+        s2 = uv2[0] - uv0[0];
+        t2 = uv2[1] - uv0[1];
+        area = s1*t2 - s2*t1;
+        sign = (area > 0.0f) ? 1.0f : -1.0f;
+        t[0] = t2*d1[0] - t1*d2[0];
+        t[1] = t2*d1[1] - t1*d2[1];
+        t[2] = t2*d1[2] - t1*d2[2];
+        len = sqrtf(t[0]*t[0] + t[1]*t[1] + t[2]*t[2]);
+        if(area != 0.0f && len > 0.0f)
+        {
+            t[0] *= sign / len;
+            t[1] *= sign / len;
+            t[2] *= sign / len;
+        }
+        else
+        {
+            t[0] = 0.0f;
+            t[1] = 0.0f;
+            t[2] = 0.0f;
+        }
+        for(k = 0; k < 3; ++k)
+        {
+            uint32_t v = tri[k];
+            const float* n = normals + v*3;
+            const float* p = positions + v*3;
+            const float* pprev = positions + tri[(k + 2) % 3]*3;
+            const float* pnext = positions + tri[(k + 1) % 3]*3;
+            float key[9];
+            float e0[3];
+            float e1[3];
+            float pt[3];
+            float angle = 0.0f;
+            float d;
+            uint32_t h;
+            uint32_t g;
+            // the angle between the edges projected onto the normal plane
+            e0[0] = pprev[0] - p[0];
+            e0[1] = pprev[1] - p[1];
+            e0[2] = pprev[2] - p[2];
+            e1[0] = pnext[0] - p[0];
+            e1[1] = pnext[1] - p[1];
+            e1[2] = pnext[2] - p[2];
+            d = n[0]*e0[0] + n[1]*e0[1] + n[2]*e0[2];
+            e0[0] -= n[0]*d;
+            e0[1] -= n[1]*d;
+            e0[2] -= n[2]*d;
+            d = n[0]*e1[0] + n[1]*e1[1] + n[2]*e1[2];
+            e1[0] -= n[0]*d;
+            e1[1] -= n[1]*d;
+            e1[2] -= n[2]*d;
+            d = sqrtf((e0[0]*e0[0] + e0[1]*e0[1] + e0[2]*e0[2]) *
+                      (e1[0]*e1[0] + e1[1]*e1[1] + e1[2]*e1[2]));
+            if(d > 0.0f)
+            {
+                d = (e0[0]*e1[0] + e0[1]*e1[1] + e0[2]*e1[2]) / d;
+                d = (d < -1.0f) ? -1.0f : ((d > 1.0f) ? 1.0f : d);
+                angle = acosf(d);
+            }
+            d = n[0]*t[0] + n[1]*t[1] + n[2]*t[2];
+            pt[0] = t[0] - n[0]*d;
+            pt[1] = t[1] - n[1]*d;
+            pt[2] = t[2] - n[2]*d;
+            len = sqrtf(pt[0]*pt[0] + pt[1]*pt[1] + pt[2]*pt[2]);
+            if(len > 0.0f)
+            {
+                angle /= len;
+            }
+            // corners with the same attributes and handedness share a frame
+            memcpy(key + 0, p, 3*sizeof(*key));
+            memcpy(key + 3, n, 3*sizeof(*key));
+            memcpy(key + 6, texcoords + v*2, 2*sizeof(*key));
+            key[8] = sign;
+            h = taa_scenemesh_hash(key, sizeof(key)) & (hashsize - 1);
+            while(hashtable[h] != ~0U &&
+                  memcmp(groupkeys + hashtable[h]*9, key, sizeof(key)))
+            {
+                h = (h + 1) & (hashsize - 1);
+            }
+            if(hashtable[h] == ~0U)
+            {
+                hashtable[h] = numgroups;
+                memcpy(groupkeys + numgroups*9, key, sizeof(key));
+                ++numgroups;
+            }
+            g = hashtable[h];
+            groupframes[g*6 + 0] += pt[0] * angle;
+            groupframes[g*6 + 1] += pt[1] * angle;
+            groupframes[g*6 + 2] += pt[2] * angle;
+            cornergroup[face->firstindex + k] = g;
+        }
+    }
+
+    // normalize the tangents of each group and complete the frames. the
+    // binormal is the cross product of the normal and tangent, negated
+    // where the texture is mirrored.
+    tanvs = taa_scenemesh_add_stream(
+        mesh,
+        "tangent",
+        taa_SCENEMESH_USAGE_TANGENT,
+        0,
+        taa_SCENEMESH_VALUE_FLOAT32,
+        3,
+        3 * sizeof(float),
+        0,
+        numverts,
+        NULL);
+    binvs = taa_scenemesh_add_stream(
+        mesh,
+        "binormal",
+        taa_SCENEMESH_USAGE_BINORMAL,
+        0,
+        taa_SCENEMESH_VALUE_FLOAT32,
+        3,
+        3 * sizeof(float),
+        0,
+        numverts,
+        NULL);
+    for(i = 0; i < numgroups; ++i)
+    {
+        const float* n = groupkeys + i*9 + 3;
+        float* t = groupframes + i*6;
+        float* b = t + 3;
+        float sign = groupkeys[i*9 + 8];
+        float len = sqrtf(t[0]*t[0] + t[1]*t[1] + t[2]*t[2]);
+        if(len > 0.0f)
+        {
+            t[0] /= len;
+            t[1] /= len;
+            t[2] /= len;
+        }
+        else
+        {
+            // no texture gradient, so any tangent on the normal plane
+            float d = (fabsf(n[0]) < 0.9f) ? n[0] : n[1];
+            t[0] = ((fabsf(n[0]) < 0.9f) ? 1.0f : 0.0f) - n[0]*d;
+            t[1] = ((fabsf(n[0]) < 0.9f) ? 0.0f : 1.0f) - n[1]*d;
+            t[2] = -n[2]*d;
+            len = sqrtf(t[0]*t[0] + t[1]*t[1] + t[2]*t[2]);
+            t[0] /= len;
+            t[1] /= len;
+            t[2] /= len;
+        }
+        b[0] = sign * (n[1]*t[2] - n[2]*t[1]);
+        b[1] = sign * (n[2]*t[0] - n[0]*t[2]);
+        b[2] = sign * (n[0]*t[1] - n[1]*t[0]);
+    }
+
+    // each vertex takes the frame of the first corner to use it, and
+    // corners with another frame get a copy of the vertex in every stream
+    maxstride = 0;
+    for(i = 0; i < mesh->numstreams; ++i)
+    {
+        if(mesh->vertexstreams[i].stride > maxstride)
+        {
+            maxstride = mesh->vertexstreams[i].stride;
+        }
+    }
+    numcopies = 0;
+    nextcap = numverts + 1;
+    vertnext = (uint32_t*) malloc(nextcap * sizeof(*vertnext));
+    vertused = (uint8_t*) calloc(numverts + 1, sizeof(*vertused));
+    vertbuf = (uint8_t*) malloc(maxstride + 1);
+    memset(vertnext, 0xff, nextcap * sizeof(*vertnext));
+    for(c = 0; c < numcorners; ++c)
+    {
+        taa_scenemesh_stream* tvs = mesh->vertexstreams + tanvs;
+        taa_scenemesh_stream* bvs = mesh->vertexstreams + binvs;
+        const float* t;
+        const float* b;
+        uint32_t v = mesh->indices[c];
+        uint32_t last = v;
+        if(cornergroup[c] == ~0U)
+        {
+            // not part of any face
+            continue;
+        }
+        t = groupframes + cornergroup[c]*6;
+        b = t + 3;
+        if(!vertused[v])
+        {
+            memcpy(tvs->buffer + v*tvs->stride, t, 3*sizeof(*t));
+            memcpy(bvs->buffer + v*bvs->stride, b, 3*sizeof(*b));
+            vertused[v] = 1;
+        }
+        while(v != ~0U && (memcmp(tvs->buffer + v*tvs->stride, t, 12) ||
+                           memcmp(bvs->buffer + v*bvs->stride, b, 12)))
+        {
+            last = v;
+            v = vertnext[v];
+        }
+        if(v == ~0U)
+        {
+            v = taa_scenemesh_duplicate_vertex(mesh,mesh->indices[c],vertbuf);
+            memcpy(tvs->buffer + v*tvs->stride, t, 3*sizeof(*t));
+            memcpy(bvs->buffer + v*bvs->stride, b, 3*sizeof(*b));
+            if(v >= nextcap)
+            {
+                nextcap *= 2;
+                vertnext = (uint32_t*) realloc(
+                    vertnext,
+                    nextcap * sizeof(*vertnext));
+            }
+            vertnext[v] = ~0U;
+            vertnext[last] = v;
+            ++numcopies;
+        }
+        mesh->indices[c] = v;
+    }
+    if(numcopies > 0)
+    {
+        taa_scenemesh_resize_meshlets(mesh, 0, 0, 0);
+        taa_scenemesh_resize_lods(mesh, 0, 0);
+    }
+    free(vertbuf);
+    free(vertused);
+    free(vertnext);
+    free(groupframes);
+    free(groupkeys);
+    free(hashtable);
+    free(cornergroup);
+    free(texcoords);
+    free(normals);
+    free(positions);
+}
+
+//****************************************************************************
+void taa_scenemesh_merge_indices(
+    taa_scenemesh* mesh)
+{
+    uint32_t size;
+    uint32_t indexsize;
+    uint32_t numdstindices;
+    uint32_t numbakindices;
+    uint32_t hashmask;
+    uint32_t* indices;
+    uint32_t* bakindices;
+    uint32_t* hashtable;
+    taa_scenemesh_face* faceitr;
+    taa_scenemesh_face* faceend;
+    taa_scenemesh_stream* dststreams;
+    taa_scenemesh_stream* vsitr;
+    taa_scenemesh_stream* vsend;
+    const taa_scenemesh_stream* vssrc;
+
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    // reserve a temporary buffer for recording merged indices. there can
+    // never be more unique combinations than there are source vertices.
+    indexsize = mesh->indexsize;
+    indices = mesh->indices;
+    numdstindices = 0;
+    size = sizeof(*bakindices) * mesh->numindices;
+    bakindices = (uint32_t*) malloc(size);
+    numbakindices = 0;
+
+    // open addressed hash table mapping index combinations to merged
+    // indices. sized to a power of two at least twice the vertex count.
+    hashmask = 1;
+    while(hashmask < (mesh->numindices / indexsize) * 2)
+    {
+        hashmask <<= 1;
+    }
+    size = sizeof(*hashtable) * hashmask;
+    hashtable = (uint32_t*) malloc(size);
+    memset(hashtable, 0xff, size);
+    --hashmask;
+
+    // loop through all the faces and map each index combination to a
+    // merged index, in order of first appearance
+    faceitr = mesh->faces;
+    faceend = faceitr + mesh->numfaces;
+    while(faceitr != faceend)
+    {
+        const uint32_t* indexsrc;
+        const uint32_t* indexsrcend;
+
+        // loop through each vertex in the face and get the merged index
+        indexsrc = indices + faceitr->firstindex;
+        indexsrcend = indexsrc + faceitr->numindices;
+        faceitr->firstindex = numdstindices;
+        while(indexsrc != indexsrcend)
+        {
+            uint32_t* slot;
+            uint32_t dstindex;
+
+            // try to find a matching vertex combination from a previous face
+            size = sizeof(*indexsrc) * indexsize;
+            slot = hashtable + (taa_scenemesh_hash(indexsrc,size) & hashmask);
+            while(*slot != ~0U)
+            {
+                if(!memcmp(bakindices + (*slot)*indexsize, indexsrc, size))
+                {
+                    break;
+                }
+                ++slot;
+                if(slot == hashtable + hashmask + 1)
+                {
+                    slot = hashtable;
+                }
+            }
+            dstindex = *slot;
+            if(dstindex == ~0U)
+            {
+                // no matching vertex combination found, create a dst vertex
+                dstindex = numbakindices++;
+                *slot = dstindex;
+                // map the merged index to the old combination
+                memcpy(bakindices + dstindex*indexsize, indexsrc, size);
+            }
+            indices[numdstindices++] = dstindex;
+            indexsrc += indexsize;
+        }
+        faceitr->numindices = numdstindices - faceitr->firstindex;
+        faceitr->numvertices = faceitr->numindices;
+        ++faceitr;
+    }
+    free(hashtable);
+    mesh->numindices = numdstindices;
+
+    // create a new set of vertex streams from the original set, sized once
+    // for the final vertex count and filled from the recorded combinations.
+    // the array is rounded to the capacity taa_scenemesh_resize_streams
+    // expects, so streams may be added afterward.
+    size = sizeof(*dststreams) * ((mesh->numstreams + 7) & ~7);
+    dststreams = (taa_scenemesh_stream*) malloc(size);
+    vsitr = dststreams;
+    vsend = vsitr + mesh->numstreams;
+    vssrc = mesh->vertexstreams;
+    while(vsitr != vsend)
+    {
+        const uint32_t* bakitr;
+        const uint32_t* bakend;
+        uint8_t* vertbuf;
+        uint32_t stride;
+        memcpy(vsitr->name, vssrc->name, sizeof(vsitr->name));
+        vsitr->usage = vssrc->usage;
+        vsitr->set = vssrc->set;
+        vsitr->valuetype = vssrc->valuetype;
+        vsitr->numcomponents = vssrc->numcomponents;
+        vsitr->stride = 0;
+        vsitr->indexmapping = 0; // all streams will use index 0 now
+        vsitr->numvertices = 0;
+        vsitr->buffer = NULL;
+        vsitr->capacity = 0;
+        vsitr->vertexhash = NULL;
+        vsitr->vertexhashsize = 0;
+        stride = vssrc->stride;
+        taa_scenemesh_resize_vertices(vsitr, stride, numbakindices);
+        // copy the vertex data to the vertex streams
+        vertbuf = vsitr->buffer;
+        bakitr = bakindices + vssrc->indexmapping;
+        bakend = bakitr + numbakindices*indexsize;
+        while(bakitr != bakend)
+        {
+            // old vert comes from data at index in old buffer
+            assert(*bakitr < vssrc->numvertices); // bad index
+            memcpy(vertbuf, vssrc->buffer + stride*(*bakitr), stride);
+            vertbuf += stride;
+            bakitr += indexsize;
+        }
+        ++vssrc;
+        ++vsitr;
+    }
+
+    // clean up the temporary buffer for holding the merged indices
+    free(bakindices);
+
+    // clean up the old vertex streams and replace with the new streams
+    vsitr = mesh->vertexstreams;
+    vsend = vsitr + mesh->numstreams;
+    while(vsitr != vsend)
+    {
+        taa_memalign_free(vsitr->buffer);
+        free(vsitr->vertexhash);
+        ++vsitr;
+    }
+    free(mesh->vertexstreams);
+    mesh->vertexstreams = dststreams;
+
+    mesh->indexsize = 1; // only one index per vertex now
+}
+
+//****************************************************************************
+int taa_scenemesh_merge_streams(
+    taa_scenemesh* mesh,
+    const char* name,
+    taa_scenemesh_stream** streams,
+    const uint32_t* streamoffsets,
+    uint32_t numstreams)
+{
+    uint32_t newnumstreams;
+    taa_scenemesh_stream* vsnew;
+    taa_scenemesh_stream** vssrcitr;
+    taa_scenemesh_stream** vssrcend;
+    taa_scenemesh_stream* vssrc;
+    taa_scenemesh_stream* vsitr;
+    taa_scenemesh_stream* vsend;
+    const uint32_t* offitr;
+
+    assert(numstreams <= mesh->numstreams); // too many streams
+
+    // create the merged stream
+    vsnew = (taa_scenemesh_stream*) malloc(sizeof(*vsnew));
+    strncpy(vsnew->name, name, sizeof(vsnew->name) - 1);
+    vsnew->name[sizeof(vsnew->name) - 1] = '\0';
+    vsnew->usage = taa_SCENEMESH_USAGE_MERGED;
+    vsnew->set = 0;
+    vsnew->valuetype = taa_SCENEMESH_VALUE_MERGED;
+    vsnew->numcomponents = 1;
+    vsnew->stride = 0;
+    vsnew->indexmapping = 0;
+    vsnew->numvertices = 0;
+    vsnew->buffer = NULL;
+    vsnew->capacity = 0;
+    vsnew->vertexhash = NULL;
+    vsnew->vertexhashsize = 0;
+
+    // determine stride, index offset, and vertex count of the merged stream
+    vssrcitr = streams;
+    vssrcend = vssrcitr + numstreams;
+    offitr = streamoffsets;
+    while(vssrcitr != vssrcend)
+    {
+        vssrc = *vssrcitr;
+        // all the merged streams should share the same index
+        assert(vssrc->indexmapping==vsnew->indexmapping || vssrcitr==streams);
+        // all the merged streams should have the same vertex count
+        assert(vssrc->numvertices==vsnew->numvertices || vssrcitr==streams);
+
+        vsnew->indexmapping = vssrc->indexmapping;
+        if(((*offitr) + vssrc->stride) > vsnew->stride)
+        {
+            taa_scenemesh_resize_vertices(
+                vsnew,
+                (*offitr) + vssrc->stride,
+                vssrc->numvertices);        
+        }
+        ++offitr;
+        ++vssrcitr;
+    }
+    // clear any padding between the elements
+    if(vsnew->numvertices > 0)
+    {
+        memset(vsnew->buffer, 0, ((size_t)vsnew->stride)*vsnew->numvertices);
+    }
+
+    // copy the vertex data from each source stream into the merged stream
+    vssrcitr = streams;
+    vssrcend = vssrcitr + numstreams;
+    offitr = streamoffsets;
+    while(vssrcitr != vssrcend)
+    {
+        uint8_t* bufitr;
+        uint8_t* bufend;
+        const uint8_t* bufsrc;
+
+        vssrc = *vssrcitr;
+        bufsrc = vssrc->buffer;
+        bufitr = vsnew->buffer + (*offitr);
+        bufend = bufitr + (vsnew->stride * vsnew->numvertices);
+        while(bufitr != bufend)
+        {
+            memcpy(bufitr, bufsrc, vssrc->stride);
+            bufsrc += vssrc->stride;
+            bufitr += vsnew->stride;
+        }
+        ++offitr;
+        ++vssrcitr;
+    }
+
+    // add original vertex streams back into new stream set
+    newnumstreams = 1; // first stream is the newly merged stream
+    vsitr = mesh->vertexstreams;
+    vsend = vsitr + mesh->numstreams;
+    while(vsitr != vsend)
+    {
+        vssrcitr = streams;
+        vssrcend = vssrcitr + numstreams;
+        while(vssrcitr != vssrcend)
+        {
+            if(*vssrcitr == vsitr)
+            {
+                // this stream is one of the merged streams
+                break;
+            }
+            ++vssrcitr;
+        }
+        if(vssrcitr == vssrcend)
+        {
+            // the stream was not merged, add it to the new stream set
+            ++newnumstreams;
+            vsnew = (taa_scenemesh_stream*) realloc(
+                vsnew,
+                sizeof(*vsnew) * newnumstreams);
+            vsnew[newnumstreams-1] = *vsitr;
+        }
+        ++vsitr;
+    }
+    assert(newnumstreams==(mesh->numstreams-numstreams)+1);
+    // round to the capacity taa_scenemesh_resize_streams expects
+    vsnew = (taa_scenemesh_stream*) realloc(
+        vsnew,
+        sizeof(*vsnew) * ((newnumstreams + 7) & ~7));
+
+    // clean up the source streams
+    vssrcitr = streams;
+    vssrcend = vssrcitr + numstreams;
+    while(vssrcitr != vssrcend)
+    {
+        vssrc = *vssrcitr;
+        taa_memalign_free(vssrc->buffer);
+        free(vssrc->vertexhash);
+        ++vssrcitr;
+    }
+    free(mesh->vertexstreams);
+
+    mesh->vertexstreams = vsnew;
+    mesh->numstreams = newnumstreams;
+    return 0; // new stream is first
+}
+
+//****************************************************************************
+int taa_scenemesh_narrow_indices(
+    taa_scenemesh* mesh)
+{
+    int result = 0;
+    const uint32_t* indexitr = mesh->indices;
+    const uint32_t* indexend = indexitr + mesh->numindices;
+    if(mesh->indexwidth == sizeof(uint32_t))
+    {
+        while(indexitr != indexend)
+        {
+            if(*indexitr > 0xffff)
+            {
+                result = -1;
+                break;
+            }
+            ++indexitr;
+        }
+        if(result == 0 && mesh->numindices > 0)
+        {
+            // pack in place, each write lands at or before the next read
+            uint16_t* dstitr = (uint16_t*) mesh->indices;
+            indexitr = mesh->indices;
+            while(indexitr != indexend)
+            {
+                *dstitr = (uint16_t) *indexitr;
+                ++dstitr;
+                ++indexitr;
+            }
+            mesh->indices = (uint32_t*) realloc(
+                mesh->indices,
+                mesh->numindices * sizeof(uint16_t));
+        }
+        if(result == 0 && mesh->numdepthindices > 0)
+        {
+            // there are no more depth vertices than mesh vertices, so the
+            // depth indices fit whenever the mesh indices do
+            uint16_t* dstitr = (uint16_t*) mesh->depthindices;
+            indexitr = mesh->depthindices;
+            indexend = indexitr + mesh->numdepthindices;
+            while(indexitr != indexend)
+            {
+                *dstitr = (uint16_t) *indexitr;
+                ++dstitr;
+                ++indexitr;
+            }
+            mesh->depthindices = (uint32_t*) realloc(
+                mesh->depthindices,
+                mesh->numdepthindices * sizeof(uint16_t));
+        }
+        if(result == 0)
+        {
+            mesh->indexwidth = sizeof(uint16_t);
+        }
+    }
+    return result;
+}
+
+//****************************************************************************
+void taa_scenemesh_optimize_overdraw(
+    taa_scenemesh* mesh,
+    float threshold)
+{
+    int32_t posvs;
+    uint32_t numverts;
+    uint32_t timestamp;
+    uint32_t* cachetimes;
+    uint32_t* tris;
+    uint32_t* hardclusters;
+    uint32_t* clusters;
+    uint32_t* order;
+    float* positions;
+    taa_scenemesh_overdrawkey* keys;
+    float meshcentroid[3];
+    float meshsum;
+    const taa_scenemesh_binding* bindingitr;
+    const taa_scenemesh_binding* bindingend;
+    uint32_t i;
+
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    // the mesh must be triangulated with merged indices
+    assert(mesh->indexsize == 1);
+    posvs = taa_scenemesh_find_stream(mesh, taa_SCENEMESH_USAGE_POSITION, 0);
+    if(posvs < 0 || mesh->numfaces == 0)
+    {
+        // nothing to sort by
+        return;
+    }
+
+    // read the positions and find the area weighted centroid of the mesh
+    numverts = mesh->vertexstreams[posvs].numvertices;
+    positions = taa_scenemesh_read_positions(mesh, posvs);
+    meshcentroid[0] = meshcentroid[1] = meshcentroid[2] = 0.0f;
+    meshsum = 0.0f;
+    for(i = 0; i < mesh->numfaces; ++i)
+    {
+        const uint32_t* t = mesh->indices + mesh->faces[i].firstindex;
+        const float* p0 = positions + t[0]*3;
+        const float* p1 = positions + t[1]*3;
+        const float* p2 = positions + t[2]*3;
+        float n[3];
+        float area;
+        taa_scenemesh_calc_tri_normal(p0, p1, p2, n);
+        area = (float) sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        meshcentroid[0] += area * (p0[0] + p1[0] + p2[0]);
+        meshcentroid[1] += area * (p0[1] + p1[1] + p2[1]);
+        meshcentroid[2] += area * (p0[2] + p1[2] + p2[2]);
+        meshsum += area * 3.0f;
+    }
+    if(meshsum > 0.0f)
+    {
+        meshcentroid[0] /= meshsum;
+        meshcentroid[1] /= meshsum;
+        meshcentroid[2] /= meshsum;
+    }
+
+    cachetimes = (uint32_t*) calloc(numverts, sizeof(*cachetimes));
+    tris = (uint32_t*) malloc(mesh->numfaces * 3 * sizeof(*tris));
+    hardclusters = (uint32_t*) malloc(mesh->numfaces * sizeof(*hardclusters));
+    clusters = (uint32_t*) malloc((mesh->numfaces + 1) * sizeof(*clusters));
+    order = (uint32_t*) malloc(mesh->numfaces * sizeof(*order));
+    keys = (taa_scenemesh_overdrawkey*) malloc(
+        mesh->numfaces * sizeof(*keys));
+    timestamp = taa_SCENEMESH_VCACHE_SIZE + 1;
+
+    bindingitr = mesh->bindings;
+    bindingend = bindingitr + mesh->numbindings;
+    while(bindingitr != bindingend)
+    {
+        uint32_t numtris = bindingitr->numfaces;
+        uint32_t numhard;
+        uint32_t numclusters;
+        uint32_t numordered;
+        uint32_t j;
+        taa_scenemesh_gather_tris(mesh, bindingitr, tris);
+
+        // hard boundaries are where the vertex cache optimized order jumps
+        // to a patch that shares no vertices with the cache
+        numhard = 0;
+        for(i = 0; i < numtris; ++i)
+        {
+            uint32_t misses = taa_scenemesh_update_fifo(
+                tris + i*3,
+                cachetimes,
+                &timestamp);
+            if(i == 0 || misses == 3)
+            {
+                hardclusters[numhard++] = i;
+            }
+        }
+
+        // split each hard cluster further wherever the running ACMR gets
+        // within the threshold of the ACMR of the whole hard cluster
+        numclusters = 0;
+        for(j = 0; j < numhard; ++j)
+        {
+            uint32_t start = hardclusters[j];
+            uint32_t end = (j + 1 < numhard) ? hardclusters[j+1] : numtris;
+            uint32_t first = numclusters;
+            uint32_t misses = 0;
+            uint32_t runmisses = 0;
+            uint32_t runtris = 0;
+            float target;
+            timestamp += taa_SCENEMESH_VCACHE_SIZE + 1;
+            for(i = start; i < end; ++i)
+            {
+                misses += taa_scenemesh_update_fifo(
+                    tris + i*3,
+                    cachetimes,
+                    &timestamp);
+            }
+            target = threshold * ((float) misses) / (end - start);
+            clusters[numclusters++] = start;
+            timestamp += taa_SCENEMESH_VCACHE_SIZE + 1;
+            for(i = start; i < end; ++i)
+            {
+                runmisses += taa_scenemesh_update_fifo(
+                    tris + i*3,
+                    cachetimes,
+                    &timestamp);
+                ++runtris;
+                if(((float) runmisses) / runtris <= target)
+                {
+                    // target reached, start a new cluster at the next tri
+                    clusters[numclusters++] = i + 1;
+                    timestamp += taa_SCENEMESH_VCACHE_SIZE + 1;
+                    runmisses = 0;
+                    runtris = 0;
+                }
+            }
+            // the final cluster is generally too small to be efficient,
+            // so merge it with the last complete cluster
+            if(numclusters - first > 1)
+            {
+                --numclusters;
+            }
+        }
+        clusters[numclusters] = numtris;
+
+        // sort clusters so that the ones facing furthest away from the
+        // center of the mesh are drawn first
+        for(j = 0; j < numclusters; ++j)
+        {
+            float c[3] = { 0.0f, 0.0f, 0.0f };
+            float n[3] = { 0.0f, 0.0f, 0.0f };
+            float sum = 0.0f;
+            float len;
+            for(i = clusters[j]; i < clusters[j + 1]; ++i)
+            {
+                const float* p0 = positions + tris[i*3 + 0]*3;
+                const float* p1 = positions + tris[i*3 + 1]*3;
+                const float* p2 = positions + tris[i*3 + 2]*3;
+                float tn[3];
+                float area;
+                taa_scenemesh_calc_tri_normal(p0, p1, p2, tn);
+                area = (float) sqrt(tn[0]*tn[0] + tn[1]*tn[1] + tn[2]*tn[2]);
+                c[0] += area * (p0[0] + p1[0] + p2[0]);
+                c[1] += area * (p0[1] + p1[1] + p2[1]);
+                c[2] += area * (p0[2] + p1[2] + p2[2]);
+                n[0] += tn[0];
+                n[1] += tn[1];
+                n[2] += tn[2];
+                sum += area * 3.0f;
+            }
+            if(sum > 0.0f)
+            {
+                c[0] /= sum;
+                c[1] /= sum;
+                c[2] /= sum;
+            }
+            len = (float) sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+            len = (len > 0.0f) ? 1.0f / len : 0.0f;
+            keys[j].cluster = j;
+            keys[j].key =
+                (c[0] - meshcentroid[0]) * n[0] * len +
+                (c[1] - meshcentroid[1]) * n[1] * len +
+                (c[2] - meshcentroid[2]) * n[2] * len;
+        }
+        qsort(keys, numclusters, sizeof(*keys), taa_scenemesh_cmp_overdrawkey);
+
+        // build the new triangle order from the sorted clusters
+        numordered = 0;
+        for(j = 0; j < numclusters; ++j)
+        {
+            uint32_t cluster = keys[j].cluster;
+            for(i = clusters[cluster]; i < clusters[cluster + 1]; ++i)
+            {
+                order[numordered++] = i;
+            }
+        }
+        assert(numordered == numtris);
+        taa_scenemesh_scatter_tris(mesh, bindingitr, tris, order);
+        ++bindingitr;
+    }
+
+    free(keys);
+    free(order);
+    free(clusters);
+    free(hardclusters);
+    free(tris);
+    free(cachetimes);
+    free(positions);
+}
+
+//****************************************************************************
+void taa_scenemesh_optimize_vertex_cache(
+    taa_scenemesh* mesh)
+{
+    uint32_t numverts;
+    uint32_t* vertlocal;
+    uint32_t* tris;
+    uint32_t* localtris;
+    uint32_t* order;
+    const taa_scenemesh_binding* bindingitr;
+    const taa_scenemesh_binding* bindingend;
+
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    // the mesh must be triangulated with merged indices
+    assert(mesh->indexsize == 1);
+
+    numverts = taa_scenemesh_calc_numindexed(mesh);
+    vertlocal = (uint32_t*) malloc(numverts * sizeof(*vertlocal));
+    memset(vertlocal, 0xff, numverts * sizeof(*vertlocal));
+    tris = (uint32_t*) malloc(mesh->numfaces * 3 * sizeof(*tris));
+    localtris = (uint32_t*) malloc(mesh->numfaces * 3 * sizeof(*localtris));
+    order = (uint32_t*) malloc(mesh->numfaces * sizeof(*order));
+
+    bindingitr = mesh->bindings;
+    bindingend = bindingitr + mesh->numbindings;
+    while(bindingitr != bindingend)
+    {
+        uint32_t numlocal;
+        uint32_t numtris;
+        uint32_t i;
+
+        // gather the triangles of the binding using local vertex ids
+        numtris = bindingitr->numfaces;
+        taa_scenemesh_gather_tris(mesh, bindingitr, tris);
+        numlocal = 0;
+        for(i = 0; i < numtris * 3; ++i)
+        {
+            uint32_t v = tris[i];
+            if(vertlocal[v] == ~0U)
+            {
+                vertlocal[v] = numlocal++;
+            }
+            localtris[i] = vertlocal[v];
+        }
+        for(i = 0; i < numtris * 3; ++i)
+        {
+            vertlocal[tris[i]] = ~0U;
+        }
+        if(numtris > 0)
+        {
+            taa_scenemesh_optimize_tris_vcache(
+                localtris,
+                numtris,
+                numlocal,
+                order);
+            taa_scenemesh_scatter_tris(mesh, bindingitr, tris, order);
+        }
+        ++bindingitr;
+    }
+
+    free(order);
+    free(localtris);
+    free(tris);
+    free(vertlocal);
+}
+
+//****************************************************************************
+void taa_scenemesh_optimize_vertex_fetch(
+    taa_scenemesh* mesh)
+{
+    uint32_t numverts;
+    uint32_t numremapped;
+    uint32_t* remap;
+    uint32_t* indexitr;
+    uint32_t* indexend;
+    taa_scenemesh_stream* vsitr;
+    taa_scenemesh_stream* vsend;
+    uint32_t i;
+
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    // all the streams must share one index
+    assert(mesh->indexsize == 1);
+    numverts = (mesh->numstreams > 0) ? mesh->vertexstreams[0].numvertices:0;
+
+    // assign new vertex ids in order of first use by the index buffer
+    remap = (uint32_t*) malloc(numverts * sizeof(*remap));
+    memset(remap, 0xff, numverts * sizeof(*remap));
+    numremapped = 0;
+    indexitr = mesh->indices;
+    indexend = indexitr + mesh->numindices;
+    while(indexitr != indexend)
+    {
+        uint32_t v = *indexitr;
+        assert(v < numverts); // bad index
+        if(remap[v] == ~0U)
+        {
+            remap[v] = numremapped++;
+        }
+        *indexitr = remap[v];
+        ++indexitr;
+    }
+    // unreferenced vertices keep their relative order at the end
+    for(i = 0; i < numverts; ++i)
+    {
+        if(remap[i] == ~0U)
+        {
+            remap[i] = numremapped++;
+        }
+    }
+
+    // move the vertices of every stream, merged or not, to their new ids
+    vsitr = mesh->vertexstreams;
+    vsend = vsitr + mesh->numstreams;
+    while(vsitr != vsend)
+    {
+        taa_scenemesh_stream tmpvs;
+        const uint8_t* vertsrc;
+        uint32_t stride = vsitr->stride;
+        assert(vsitr->indexmapping == 0);
+        assert(vsitr->numvertices == numverts); // stream size mismatch
+        tmpvs = *vsitr;
+        tmpvs.stride = 0;
+        tmpvs.numvertices = 0;
+        tmpvs.buffer = NULL;
+        tmpvs.capacity = 0;
+        tmpvs.vertexhash = NULL;
+        tmpvs.vertexhashsize = 0;
+        taa_scenemesh_resize_vertices(&tmpvs, stride, numverts);
+        vertsrc = vsitr->buffer;
+        for(i = 0; i < numverts; ++i)
+        {
+            memcpy(tmpvs.buffer + remap[i]*stride, vertsrc, stride);
+            vertsrc += stride;
+        }
+        taa_memalign_free(vsitr->buffer);
+        if(vsitr->vertexhash != NULL)
+        {
+            free(vsitr->vertexhash);
+            taa_scenemesh_rehash_vertices(&tmpvs);
+        }
+        *vsitr = tmpvs;
+        ++vsitr;
+    }
+    // keep the meshlets and lods referencing the same vertices
+    for(i = 0; i < mesh->nummeshletvertices; ++i)
+    {
+        mesh->meshletvertices[i] = remap[mesh->meshletvertices[i]];
+    }
+    for(i = 0; i < mesh->numlodindices; ++i)
+    {
+        mesh->lodindices[i] = remap[mesh->lodindices[i]];
+    }
+    free(remap);
+}
+
+//****************************************************************************
+int taa_scenemesh_plan_format(
+    taa_scenemesh_vertformat* vf,
+    int numvf,
+    uint32_t alignment)
+{
+    taa_scenemesh_access group;
+    uint32_t numstreams = 0;
+    uint32_t* order;
+    int32_t i;
+
+    alignment = (alignment < 4) ? 4 : alignment;
+    order = (uint32_t*) malloc((numvf + 1) * sizeof(*order));
+    for(group = taa_SCENEMESH_ACCESS_HOT;
+        group <= taa_SCENEMESH_ACCESS_COLD;
+        group = (taa_scenemesh_access) (group + 1))
+    {
+        uint32_t numorder = 0;
+        uint32_t offset = 0;
+        uint32_t j;
+        // gather the elements of the group, sorted by decreasing alignment
+        // with ties kept in their original order. each is then placed at
+        // the next offset that meets its alignment.
+        for(i = 0; i < numvf; ++i)
+        {
+            taa_scenemesh_access access = vf[i].access;
+            uint32_t align;
+            if(access == taa_SCENEMESH_ACCESS_DEFAULT)
+            {
+                // positions alone are read by depth and shadow passes
+                access = taa_SCENEMESH_ACCESS_WARM;
+                if(vf[i].usage == taa_SCENEMESH_USAGE_POSITION &&
+                   vf[i].set == 0)
+                {
+                    access = taa_SCENEMESH_ACCESS_HOT;
+                }
+            }
+            if(access != group)
+            {
+                continue;
+            }
+            align = taa_scenemesh_calc_stride(vf[i].valuetype, 1);
+            align = (align < alignment) ? alignment : align;
+            j = numorder;
+            while(j > 0)
+            {
+                uint32_t prev = order[j - 1];
+                uint32_t prevalign;
+                prevalign = taa_scenemesh_calc_stride(vf[prev].valuetype, 1);
+                prevalign = (prevalign < alignment) ? alignment : prevalign;
+                if(prevalign >= align)
+                {
+                    break;
+                }
+                order[j] = prev;
+                --j;
+            }
+            order[j] = (uint32_t) i;
+            ++numorder;
+        }
+        for(j = 0; j < numorder; ++j)
+        {
+            taa_scenemesh_vertformat* v = vf + order[j];
+            uint32_t size;
+            uint32_t align;
+            size = taa_scenemesh_calc_stride(v->valuetype, v->numcomponents);
+            align = taa_scenemesh_calc_stride(v->valuetype, 1);
+            align = (align < alignment) ? alignment : align;
+            offset = (offset + align - 1) & ~(align - 1);
+            v->stream = numstreams;
+            v->offset = offset;
+            offset += size;
+            if(group == taa_SCENEMESH_ACCESS_COLD)
+            {
+                // cold elements keep streams of their own
+                offset = 0;
+                ++numstreams;
+            }
+        }
+        if(group != taa_SCENEMESH_ACCESS_COLD && numorder > 0)
+        {
+            ++numstreams;
+        }
+    }
+    free(order);
+    return (int) numstreams;
+}
+
+//****************************************************************************
+void taa_scenemesh_prune_influences(
+    taa_scenemesh* mesh,
+    uint32_t maxinfluences)
+{
+    int32_t indexvs;
+    int32_t weightvs;
+    taa_scenemesh_stream* ivs;
+    taa_scenemesh_stream* wvs;
+    taa_scenemesh_stream newivs;
+    taa_scenemesh_stream newwvs;
+    taa_scenemesh_valuetype indextype;
+    uint32_t numinfluences;
+    uint32_t numverts;
+    uint32_t numjoints;
+    uint32_t* jointremap;
+    uint32_t* joints;
+    uint8_t* weights;
+    uint32_t i;
+
+    assert(maxinfluences > 0);
+    assert(maxinfluences <= taa_SCENEMESH_MAXINFLUENCES);
+    assert(mesh->numpalettejoints == 0); // prune before split_palettes
+    indexvs = taa_scenemesh_find_stream(
+        mesh,
+        taa_SCENEMESH_USAGE_BLENDINDEX,
+        0);
+    weightvs = taa_scenemesh_find_stream(
+        mesh,
+        taa_SCENEMESH_USAGE_BLENDWEIGHT,
+        0);
+    if(indexvs < 0 || weightvs < 0)
+    {
+        return;
+    }
+    ivs = mesh->vertexstreams + indexvs;
+    wvs = mesh->vertexstreams + weightvs;
+    assert(ivs->indexmapping == wvs->indexmapping);
+    assert(ivs->numvertices == wvs->numvertices);
+    numverts = ivs->numvertices;
+    numinfluences = ivs->numcomponents;
+    if(wvs->numcomponents < numinfluences)
+    {
+        numinfluences = wvs->numcomponents;
+    }
+    assert(numinfluences <= taa_SCENEMESH_MAXINFLUENCES);
+    if(maxinfluences > numinfluences)
+    {
+        maxinfluences = numinfluences;
+    }
+    jointremap = (uint32_t*) malloc((mesh->numjoints+1)*sizeof(*jointremap));
+    joints = (uint32_t*) malloc((numverts*maxinfluences+1)*sizeof(*joints));
+    weights = (uint8_t*) malloc(numverts*maxinfluences + 1);
+    memset(jointremap, 0xff, mesh->numjoints * sizeof(*jointremap));
+
+    // keep the heaviest influences of each vertex
+    for(i = 0; i < numverts; ++i)
+    {
+        float jointvals[taa_SCENEMESH_MAXINFLUENCES];
+        float w[taa_SCENEMESH_MAXINFLUENCES];
+        uint32_t* vj = joints + i*maxinfluences;
+        uint8_t* vw = weights + i*maxinfluences;
+        float sum = 0.0f;
+        int32_t total = 0;
+        uint32_t j;
+        taa_scenemesh_read_floats(ivs, i, jointvals, numinfluences);
+        taa_scenemesh_read_floats(wvs, i, w, numinfluences);
+        for(j = 1; j < numinfluences; ++j)
+        {
+            // insertion sort by descending weight
+            float jv = jointvals[j];
+            float wv = w[j];
+            uint32_t k = j;
+            while(k > 0 && w[k-1] < wv)
+            {
+                jointvals[k] = jointvals[k-1];
+                w[k] = w[k-1];
+                --k;
+            }
+            jointvals[k] = jv;
+            w[k] = wv;
+        }
+        for(j = 0; j < maxinfluences; ++j)
+        {
+            if(w[j] > 0.0f)
+            {
+                sum += w[j];
+            }
+        }
+        for(j = 0; j < maxinfluences; ++j)
+        {
+            vj[j] = 0;
+            vw[j] = 0;
+            if(w[j] > 0.0f)
+            {
+                // renormalize and quantize to 8 bits
+                vj[j] = (uint32_t) jointvals[j];
+                vw[j] = (uint8_t) floor((w[j]/sum)*255.0f + 0.5f);
+                total += vw[j];
+                assert(vj[j] < mesh->numjoints);
+            }
+        }
+        if(total > 0)
+        {
+            // the quantized weights must still add to one, so the rounding
+            // error goes to the heaviest influence
+            vw[0] = (uint8_t) (vw[0] + (255 - total));
+        }
+        for(j = 0; j < maxinfluences; ++j)
+        {
+            if(vw[j] != 0)
+            {
+                // influences that quantize to nothing do not keep a joint
+                jointremap[vj[j]] = 0;
+            }
+        }
+    }
+
+    // drop joints that no longer influence any vertex
+    numjoints = 0;
+    for(i = 0; i < mesh->numjoints; ++i)
+    {
+        if(jointremap[i] != ~0U)
+        {
+            jointremap[i] = numjoints;
+            mesh->joints[numjoints] = mesh->joints[i];
+            ++numjoints;
+        }
+    }
+    taa_scenemesh_resize_skinjoints(mesh, numjoints);
+    indextype = taa_SCENEMESH_VALUE_UINT8;
+    if(numjoints > 256)
+    {
+        indextype = taa_SCENEMESH_VALUE_UINT16;
+    }
+
+    // replace the streams with packed ones. unused influences have an
+    // index and weight of 0.
+    newivs = *ivs;
+    newivs.valuetype = indextype;
+    newivs.numcomponents = maxinfluences;
+    newivs.stride = 0;
+    newivs.numvertices = 0;
+    newivs.buffer = NULL;
+    newivs.capacity = 0;
+    newivs.vertexhash = NULL;
+    newivs.vertexhashsize = 0;
+    taa_scenemesh_resize_vertices(
+        &newivs,
+        taa_scenemesh_calc_stride(indextype, maxinfluences),
+        numverts);
+    newwvs = *wvs;
+    newwvs.valuetype = taa_SCENEMESH_VALUE_UNORM8;
+    newwvs.numcomponents = maxinfluences;
+    newwvs.stride = 0;
+    newwvs.numvertices = 0;
+    newwvs.buffer = NULL;
+    newwvs.capacity = 0;
+    newwvs.vertexhash = NULL;
+    newwvs.vertexhashsize = 0;
+    taa_scenemesh_resize_vertices(&newwvs, maxinfluences, numverts);
+    if(numverts > 0)
+    {
+        memcpy(newwvs.buffer, weights, numverts*maxinfluences);
+    }
+    for(i = 0; i < numverts*maxinfluences; ++i)
+    {
+        uint32_t joint = (weights[i] != 0) ? jointremap[joints[i]] : 0;
+        if(indextype == taa_SCENEMESH_VALUE_UINT8)
+        {
+            newivs.buffer[i] = (uint8_t) joint;
+        }
+        else
+        {
+            ((uint16_t*) newivs.buffer)[i] = (uint16_t) joint;
+        }
+    }
+    taa_memalign_free(ivs->buffer);
+    if(ivs->vertexhash != NULL)
+    {
+        free(ivs->vertexhash);
+        taa_scenemesh_rehash_vertices(&newivs);
+    }
+    *ivs = newivs;
+    taa_memalign_free(wvs->buffer);
+    if(wvs->vertexhash != NULL)
+    {
+        free(wvs->vertexhash);
+        taa_scenemesh_rehash_vertices(&newwvs);
+    }
+    *wvs = newwvs;
+    free(weights);
+    free(joints);
+    free(jointremap);
+}
+
+//****************************************************************************
+float taa_scenemesh_quantize_stream(
+    taa_scenemesh* mesh,
+    taa_scenemesh_stream* vs,
+    taa_scenemesh_quantize quantize,
+    taa_scenemesh_valuetype valuetype,
+    unsigned int numcomponents)
+{
+    taa_scenemesh_quantization* q;
+    taa_scenemesh_stream* ds;
+    float vmin[4];
+    float vmax[4];
+    int snorm;
+    uint32_t i;
+    uint32_t j;
+
+    // if the source vertex stream is a merged aggregate,
+    // it cannot be quantized
+    assert(vs->valuetype != taa_SCENEMESH_VALUE_MERGED);
+    assert(valuetype >= taa_SCENEMESH_VALUE_SNORM8);
+    assert(numcomponents >= 1 && numcomponents <= 4);
+    assert(taa_scenemesh_find_quantization(mesh,vs->usage,vs->set) < 0);
+    snorm = (valuetype == taa_SCENEMESH_VALUE_SNORM8 ||
+             valuetype == taa_SCENEMESH_VALUE_SNORM16);
+
+    // add the decode record
+    taa_scenemesh_resize_quantizations(mesh, mesh->numquantizations + 1);
+    q = mesh->quantizations + (mesh->numquantizations - 1);
+    q->usage = vs->usage;
+    q->set = vs->set;
+    q->quantize = quantize;
+    for(j = 0; j < 4; ++j)
+    {
+        q->scale[j] = 1.0f;
+        q->bias[j] = 0.0f;
+        vmin[j] = 0.0f;
+        vmax[j] = 0.0f;
+    }
+    if(quantize == taa_SCENEMESH_QUANTIZE_BOUNDS)
+    {
+        // calculate the bounds of each component, which are mapped to the
+        // range of valuetype
+        for(i = 0; i < vs->numvertices; ++i)
+        {
+            float v[4];
+            taa_scenemesh_read_floats(vs, i, v, 4);
+            for(j = 0; j < 4; ++j)
+            {
+                if(i == 0 || v[j] < vmin[j]) vmin[j] = v[j];
+                if(i == 0 || v[j] > vmax[j]) vmax[j] = v[j];
+            }
+        }
+        for(j = 0; j < 4; ++j)
+        {
+            float range = vmax[j] - vmin[j];
+            range = (range > 0.0f) ? range : 1.0f;
+            q->scale[j] = (snorm) ? range * 0.5f : range;
+            q->bias[j] = (snorm) ? (vmax[j] + vmin[j]) * 0.5f : vmin[j];
+        }
+    }
+    else
+    {
+        assert(quantize == taa_SCENEMESH_QUANTIZE_OCTAHEDRAL);
+        assert(snorm);
+        assert(numcomponents == 2 || numcomponents == 3);
+    }
+
+    // encode the values, and the depth positions the same way so that
+    // they stay identical to the positions they were copied from
+    ds = &mesh->depthstream;
+    assert(vs != ds);
+    if(ds->numvertices > 0 &&
+       ds->usage == vs->usage &&
+       ds->set == vs->set &&
+       ds->valuetype == vs->valuetype &&
+       ds->numcomponents == vs->numcomponents)
+    {
+        taa_scenemesh_write_quantized(ds, q, valuetype, numcomponents);
+    }
+    q->maxerror = taa_scenemesh_write_quantized(
+        vs,
+        q,
+        valuetype,
+        numcomponents);
+    return q->maxerror;
+}
+
+//****************************************************************************
+void taa_scenemesh_remove_degenerates(
+    taa_scenemesh* mesh)
+{
+    int32_t posvs;
+    uint32_t indexsize = mesh->indexsize;
+    uint32_t posmapping = 0;
+    uint32_t trisize = 3 * indexsize;
+    uint32_t maxfaces = 0;
+    uint32_t hashsize = 16;
+    uint32_t numfaces = 0;
+    uint32_t size;
+    float* positions = NULL;
+    uint32_t* hashtable;
+    uint32_t* key;
+    uint32_t* otherkey;
+    uint32_t* newindices;
+    taa_scenemesh_face* newfaces;
+    uint32_t b;
+
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    posvs = taa_scenemesh_find_stream(mesh, taa_SCENEMESH_USAGE_POSITION, 0);
+    if(posvs >= 0)
+    {
+        posmapping = mesh->vertexstreams[posvs].indexmapping;
+        positions = taa_scenemesh_read_positions(mesh, posvs);
+    }
+    for(b = 0; b < mesh->numbindings; ++b)
+    {
+        if(mesh->bindings[b].numfaces > maxfaces)
+        {
+            maxfaces = mesh->bindings[b].numfaces;
+        }
+    }
+    while(hashsize < maxfaces * 2)
+    {
+        hashsize <<= 1;
+    }
+    // the new buffers use the capacities of the resize functions
+    size = sizeof(*newfaces) * ((mesh->numfaces + 1023) & ~1023);
+    newfaces = (taa_scenemesh_face*) malloc(size);
+    size = sizeof(*newindices) * ((mesh->numindices + 1023) & ~1023);
+    newindices = (uint32_t*) malloc(size);
+    hashtable = (uint32_t*) malloc(hashsize * sizeof(*hashtable));
+    key = (uint32_t*) malloc(trisize * sizeof(*key));
+    otherkey = (uint32_t*) malloc(trisize * sizeof(*otherkey));
+
+    for(b = 0; b < mesh->numbindings; ++b)
+    {
+        taa_scenemesh_binding* bind = mesh->bindings + b;
+        uint32_t firstface = numfaces;
+        uint32_t bindhash = 16;
+        uint32_t f;
+        // duplicates are only found within a binding
+        while(bindhash < bind->numfaces * 2)
+        {
+            bindhash <<= 1;
+        }
+        memset(hashtable, 0xff, bindhash * sizeof(*hashtable));
+        for(f = bind->firstface; f < bind->firstface + bind->numfaces; ++f)
+        {
+            const taa_scenemesh_face* face = mesh->faces + f;
+            const uint32_t* tri = mesh->indices + face->firstindex;
+            uint32_t p0 = tri[posmapping];
+            uint32_t p1 = tri[posmapping + indexsize];
+            uint32_t p2 = tri[posmapping + indexsize*2];
+            uint32_t h;
+            assert(face->numvertices == 3); // must be triangulated
+            if(posvs < 0)
+            {
+                // without positions, corners must differ in every index
+                size = indexsize * sizeof(*tri);
+                if(!memcmp(tri, tri + indexsize, size) ||
+                   !memcmp(tri + indexsize, tri + indexsize*2, size) ||
+                   !memcmp(tri, tri + indexsize*2, size))
+                {
+                    continue;
+                }
+            }
+            else if(p0 == p1 || p1 == p2 || p0 == p2)
+            {
+                // repeated position index
+                continue;
+            }
+            else
+            {
+                float n[3];
+                taa_scenemesh_calc_tri_normal(
+                    positions + p0*3,
+                    positions + p1*3,
+                    positions + p2*3,
+                    n);
+                if(n[0] == 0.0f && n[1] == 0.0f && n[2] == 0.0f)
+                {
+                    // zero area
+                    continue;
+                }
+            }
+            taa_scenemesh_calc_tri_key(tri, indexsize, key);
+            h = taa_scenemesh_hash(key, trisize*sizeof(*key)) & (bindhash-1);
+            while(hashtable[h] != ~0U)
+            {
+                const taa_scenemesh_face* other = newfaces + hashtable[h];
+                taa_scenemesh_calc_tri_key(
+                    newindices + other->firstindex,
+                    indexsize,
+                    otherkey);
+                if(!memcmp(key, otherkey, trisize * sizeof(*key)))
+                {
+                    break;
+                }
+                h = (h + 1) & (bindhash - 1);
+            }
+            if(hashtable[h] != ~0U)
+            {
+                // exact duplicate of an earlier triangle, found through a
+                // hash of its indices
+                continue;
+            }
+            hashtable[h] = numfaces;
+            newfaces[numfaces].firstindex = numfaces * trisize;
+            newfaces[numfaces].numindices = trisize;
+            newfaces[numfaces].numvertices = 3;
+            memcpy(
+                newindices + numfaces*trisize,
+                tri,
+                trisize * sizeof(*tri));
+            ++numfaces;
+        }
+        bind->firstface = firstface;
+        bind->numfaces = numfaces - firstface;
+    }
+    free(mesh->faces);
+    mesh->faces = newfaces;
+    mesh->numfaces = numfaces;
+    free(mesh->indices);
+    mesh->indices = newindices;
+    mesh->numindices = numfaces * trisize;
+    free(otherkey);
+    free(key);
+    free(hashtable);
+    free(positions);
+}
+
+//****************************************************************************
+void taa_scenemesh_remove_stream(
+    taa_scenemesh* mesh,
+    taa_scenemesh_stream* vs)
+{
+    uint32_t i;
+    uint32_t iend;
+    uint32_t removeoffset;
+    taa_scenemesh_stream* vsitr;
+    taa_scenemesh_stream* vsend;
+
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    removeoffset = 1; // true
+    vsitr = mesh->vertexstreams;
+    vsend = vsitr + mesh->numstreams;
+    while(vsitr != vsend)
+    {
+        if((vsitr != vs) && vsitr->indexmapping == vs->indexmapping)
+        {
+            // the indices are shared with another vertex stream
+            removeoffset = 0; // false
+            break;
+        }
+        ++vsitr;
+    }
+
+    if(removeoffset)
+    {
+        taa_scenemesh_face* faceitr;
+        taa_scenemesh_face* faceend;
+        uint32_t* indexitr;
+
+        // remove indices from index buffer and all the faces
+        removeoffset = vs->indexmapping;
+        iend = mesh->indexsize--;
+        faceitr = mesh->faces;
+        faceend = faceitr + mesh->numfaces;
+        indexitr = mesh->indices;
+        while(faceitr != faceend)
+        {
+            const uint32_t* indexsrc;
+            const uint32_t* indexsrcend;
+            uint32_t* indexoff;
+
+            indexoff = indexitr;
+            indexsrc = mesh->indices + faceitr->firstindex;
+            indexsrcend = indexsrc + faceitr->numindices;
+            while(indexsrc != indexsrcend)
+            {
+                for(i = 0; i != iend; ++i)
+                {
+                    if(i != removeoffset)
+                    {
+                        *indexitr = *indexsrc;
+                        ++indexitr;
+                    }
+                    ++indexsrc;
+                }
+            }
+            faceitr->firstindex = (uint32_t) (indexoff - mesh->indices);
+            faceitr->numindices = (uint32_t) (indexitr - indexoff);
+            assert(faceitr->numindices ==
+                   faceitr->numvertices * mesh->indexsize);
+            ++faceitr;
+        }
+
+        // fix offsets of any affected vertex streams
+        vsitr = mesh->vertexstreams;
+        vsend = vsitr + mesh->numstreams;
+        while(vsitr != vsend)
+        {
+            if(removeoffset != 0 && vsitr->indexmapping > removeoffset)
+            {
+                --vsitr->indexmapping;
+            }
+            ++vsitr;
+        }
+        mesh->numindices = (uint32_t) (indexitr - mesh->indices);
+    }
+    // drop the decode parameters of a quantized stream
+    i = (uint32_t) taa_scenemesh_find_quantization(mesh, vs->usage, vs->set);
+    if(i != ~0U)
+    {
+        --mesh->numquantizations;
+        memmove(
+            mesh->quantizations + i,
+            mesh->quantizations + i + 1,
+            (mesh->numquantizations - i) * sizeof(*mesh->quantizations));
+    }
+    // clean up the vertex stream and remove from array
+    taa_memalign_free(vs->buffer);
+    free(vs->vertexhash);
+    --mesh->numstreams;
+    vsitr = vs;
+    vsend = mesh->vertexstreams + mesh->numstreams;
+    while(vsitr != vsend)
+    {
+        *vsitr = *(vsitr + 1);
+        ++vsitr;
+    }
+}
+
+//****************************************************************************
+void taa_scenemesh_reserve_vertices(
+    taa_scenemesh_stream* vs,
+    uint32_t numverts)
+{
+    size_t size = ((size_t) vs->stride) * numverts;
+    if(size > vs->capacity)
+    {
+        size = (size + 15) & ~((size_t) 15);
+        vs->buffer = (uint8_t*) taa_scenemesh_aligned_realloc(
+            vs->buffer,
+            16,
+            ((size_t) vs->stride) * vs->numvertices,
+            size);
+        vs->capacity = size;
+    }
+}
+
+//****************************************************************************
+void taa_scenemesh_resize_bindings(
+    taa_scenemesh* mesh,
+    uint32_t numbindings)
+{
+    uint32_t oldnum = mesh->numbindings;
+    taa_scenemesh_binding* binding = mesh->bindings;
+    if(numbindings > oldnum)
+    {
+        uint32_t cap = (oldnum     +7) & ~7;
+        uint32_t ncap= (numbindings+7) & ~7;
+        if(cap != ncap)
+        {
+            binding = (taa_scenemesh_binding*) realloc(
+                binding,
+                ncap * sizeof(*binding));
+            mesh->bindings = binding;
+        }
+        binding += oldnum;
+        memset(binding, 0, (numbindings-oldnum) * sizeof(*binding));
+    }
+    mesh->numbindings = numbindings;
+}
+
+//****************************************************************************
+void taa_scenemesh_resize_depthindices(
+    taa_scenemesh* mesh,
+    uint32_t numdepthindices)
+{
+    uint32_t oldnum = mesh->numdepthindices;
+    uint32_t* indices = mesh->depthindices;
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    if(numdepthindices > oldnum)
+    {
+        uint32_t cap = (oldnum          + 1023) & ~1023;
+        uint32_t ncap= (numdepthindices + 1023) & ~1023;
+        if(cap != ncap)
+        {
+            // realloc the index buffer to nearest 1k capacity
+            indices = (uint32_t*) realloc(
+                indices,
+                ncap * sizeof(*indices));
+            mesh->depthindices = indices;
+        }
+        indices += oldnum;
+        memset(indices, 0, (numdepthindices-oldnum) * sizeof(*indices));
+    }
+    mesh->numdepthindices = numdepthindices;
+}
+
+//****************************************************************************
+void taa_scenemesh_resize_faces(
+    taa_scenemesh* mesh,
+    uint32_t numfaces)
+{
+    uint32_t oldnum = mesh->numfaces;
+    taa_scenemesh_face* face = mesh->faces;
+    if(numfaces > oldnum)
+    {
+        uint32_t cap = (oldnum   + 1023) & ~1023;
+        uint32_t ncap= (numfaces + 1023) & ~1023;
+        if(cap != ncap)
+        {
+            // realloc the face buffer to nearest 1k capacity
+            face = (taa_scenemesh_face*) realloc(
+                face,
+                ncap * sizeof(*face));
+            mesh->faces = face;
+        }
+        face += oldnum;
+        memset(face, 0, (numfaces-oldnum) * sizeof(*face));
+    }
+    mesh->numfaces = numfaces;
+}
+
+//****************************************************************************
+void taa_scenemesh_resize_indices(
+    taa_scenemesh* mesh,
+    uint32_t numindices)
+{
+    uint32_t oldnum = mesh->numindices;
+    uint32_t* indices = mesh->indices;
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    if(numindices > oldnum)
+    {
+        uint32_t cap = (oldnum     + 1023) & ~1023;
+        uint32_t ncap= (numindices + 1023) & ~1023;
+        if(cap != ncap)
+        {
+            // realloc the face buffer to nearest 1k capacity
+            indices = (uint32_t*) realloc(
+                indices,
+                ncap * sizeof(*indices));
+            mesh->indices = indices;
+        }
+        indices += oldnum;
+        memset(indices, 0, (numindices-oldnum) * sizeof(*indices));
+    }
+    mesh->numindices = numindices;
+}
+
+//****************************************************************************
+void taa_scenemesh_resize_lods(
+    taa_scenemesh* mesh,
+    uint32_t numlods,
+    uint32_t numlodindices)
+{
+    uint32_t cap;
+    uint32_t ncap;
+    if(numlods > mesh->numlods)
+    {
+        taa_scenemesh_lod* lod = mesh->lods;
+        cap = (mesh->numlods+7) & ~7;
+        ncap= (numlods      +7) & ~7;
+        if(cap != ncap)
+        {
+            lod = (taa_scenemesh_lod*) realloc(lod, ncap * sizeof(*lod));
+            mesh->lods = lod;
+        }
+        lod += mesh->numlods;
+        memset(lod, 0, (numlods - mesh->numlods) * sizeof(*lod));
+    }
+    if(numlodindices > mesh->numlodindices)
+    {
+        cap = (mesh->numlodindices+1023) & ~1023;
+        ncap= (numlodindices      +1023) & ~1023;
+        if(cap != ncap)
+        {
+            mesh->lodindices = (uint32_t*) realloc(
+                mesh->lodindices,
+                ncap * sizeof(*mesh->lodindices));
+        }
+    }
+    mesh->numlods = numlods;
+    mesh->numlodindices = numlodindices;
+}
+
+//****************************************************************************
+void taa_scenemesh_resize_meshlets(
+    taa_scenemesh* mesh,
+    uint32_t nummeshlets,
+    uint32_t nummeshletvertices,
+    uint32_t nummeshletindices)
+{
+    uint32_t cap;
+    uint32_t ncap;
+    if(nummeshlets > mesh->nummeshlets)
+    {
+        taa_scenemesh_meshlet* meshlet = mesh->meshlets;
+        cap = (mesh->nummeshlets+7) & ~7;
+        ncap= (nummeshlets      +7) & ~7;
+        if(cap != ncap)
+        {
+            meshlet = (taa_scenemesh_meshlet*) realloc(
+                meshlet,
+                ncap * sizeof(*meshlet));
+            mesh->meshlets = meshlet;
+        }
+        meshlet += mesh->nummeshlets;
+        memset(meshlet,0,(nummeshlets-mesh->nummeshlets)*sizeof(*meshlet));
+    }
+    if(nummeshletvertices > mesh->nummeshletvertices)
+    {
+        cap = (mesh->nummeshletvertices+1023) & ~1023;
+        ncap= (nummeshletvertices      +1023) & ~1023;
+        if(cap != ncap)
+        {
+            mesh->meshletvertices = (uint32_t*) realloc(
+                mesh->meshletvertices,
+                ncap * sizeof(*mesh->meshletvertices));
+        }
+    }
+    if(nummeshletindices > mesh->nummeshletindices)
+    {
+        cap = (mesh->nummeshletindices+1023) & ~1023;
+        ncap= (nummeshletindices      +1023) & ~1023;
+        if(cap != ncap)
+        {
+            mesh->meshletindices = (uint8_t*) realloc(
+                mesh->meshletindices,
+                ncap * sizeof(*mesh->meshletindices));
+        }
+    }
+    mesh->nummeshlets = nummeshlets;
+    mesh->nummeshletvertices = nummeshletvertices;
+    mesh->nummeshletindices = nummeshletindices;
+}
+
+//****************************************************************************
+void taa_scenemesh_resize_palettejoints(
+    taa_scenemesh* mesh,
+    uint32_t numpalettejoints)
+{
+    if(numpalettejoints > mesh->numpalettejoints)
+    {
+        uint32_t cap = (mesh->numpalettejoints+1023) & ~1023;
+        uint32_t ncap= (numpalettejoints      +1023) & ~1023;
+        if(cap != ncap)
+        {
+            mesh->palettejoints = (uint32_t*) realloc(
+                mesh->palettejoints,
+                ncap * sizeof(*mesh->palettejoints));
+        }
+    }
+    mesh->numpalettejoints = numpalettejoints;
+}
+
+//****************************************************************************
+void taa_scenemesh_resize_quantizations(
+    taa_scenemesh* mesh,
+    uint32_t numquantizations)
+{
+    uint32_t oldnum = mesh->numquantizations;
+    taa_scenemesh_quantization* q = mesh->quantizations;
+    if(numquantizations > oldnum)
+    {
+        uint32_t cap = (oldnum          +7) & ~7;
+        uint32_t ncap= (numquantizations+7) & ~7;
+        if(cap != ncap)
+        {
+            q = (taa_scenemesh_quantization*) realloc(
+                q,
+                ncap * sizeof(*q));
+            mesh->quantizations = q;
+        }
+        q += oldnum;
+        memset(q, 0, (numquantizations-oldnum) * sizeof(*q));
+    }
+    mesh->numquantizations = numquantizations;
+}
+
+//****************************************************************************
+void taa_scenemesh_resize_skinjoints(
+    taa_scenemesh* mesh,
+    uint32_t numjoints)
+{
+    uint32_t oldnum = mesh->numjoints;
+    taa_scenemesh_skinjoint* joint = mesh->joints;
+    uint32_t cap = (oldnum   +31) & ~31;
+    uint32_t ncap= (numjoints+31) & ~31;
+    if(cap != ncap)
+    {
+        joint = (taa_scenemesh_skinjoint*) taa_scenemesh_aligned_realloc(
+            joint,
+            16,
+            cap * sizeof(*joint),
+            ncap * sizeof(*joint));
+        mesh->joints = joint;
+    }
+    if(numjoints > oldnum)
+    {
+        joint += oldnum;
+        memset(joint, 0, (numjoints-oldnum) * sizeof(*joint));
+    }
+    mesh->numjoints = numjoints;
+}
+
+//****************************************************************************
+void taa_scenemesh_resize_streams(
+    taa_scenemesh* mesh,
+    uint32_t numstreams)
+{
+    uint32_t oldnum = mesh->numstreams;
+    taa_scenemesh_stream* vs = mesh->vertexstreams;
+    if(numstreams > oldnum)
+    {
+        uint32_t cap = (oldnum    +7) & ~7;
+        uint32_t ncap= (numstreams+7) & ~7;
+        if(cap != ncap)
+        {
+            vs = (taa_scenemesh_stream*) realloc(vs, ncap * sizeof(*vs));
+            mesh->vertexstreams = vs;
+        }
+        vs += oldnum;
+        memset(vs, 0, (numstreams-oldnum) * sizeof(*vs));
+    }
+    mesh->numstreams = numstreams;
+}
+
+//****************************************************************************
+void taa_scenemesh_resize_vertices(
+    taa_scenemesh_stream* vs,
+    uint32_t stride,
+    uint32_t numverts)
+{
+    size_t oldsz = ((size_t) vs->stride) * vs->numvertices;
+    size_t newsz = ((size_t) stride) * numverts;
+    if(newsz > vs->capacity)
+    {
+        // grow by half again, so appending one vertex at a time is linear
+        size_t cap = vs->capacity + vs->capacity/2;
+        cap = (cap < newsz) ? newsz : cap;
+        cap = (cap + 15) & ~((size_t) 15);
+        vs->buffer = (uint8_t*) taa_scenemesh_aligned_realloc(
+            vs->buffer,
+            16,
+            oldsz,
+            cap);
+        vs->capacity = cap;
+    }
+    if(vs->vertexhash!=NULL && (numverts<vs->numvertices||stride!=vs->stride))
+    {
+        // removed vertices must not remain in the hash
+        vs->stride = stride;
+        vs->numvertices = numverts;
+        taa_scenemesh_rehash_vertices(vs);
+    }
+    vs->stride = stride;
+    vs->numvertices = numverts;
+}
+
+//****************************************************************************
+void taa_scenemesh_rotate_upaxis(
+    taa_scenemesh* mesh,
+    int32_t dir)
+{
+    taa_scenemesh_skinjoint* jointitr = mesh->joints;
+    taa_scenemesh_skinjoint* jointend = jointitr + mesh->numjoints;
+    taa_scenemesh_stream* vsitr = mesh->vertexstreams;
+    taa_scenemesh_stream* vsend = vsitr + mesh->numstreams;
+    taa_scenemesh_stream* ds = &mesh->depthstream;
+    taa_mat44 pitch;
+    taa_mat44 invpitch;
+    uint32_t i;
+    if(ds->numcomponents >= 3)
+    {
+        // a quantized depth stream shares the decode parameters of the
+        // positions, so rotate it with a copy before the positions change
+        // them. the record only applies if the formats still match.
+        int q = taa_scenemesh_find_quantization(mesh, ds->usage, ds->set);
+        int ps = taa_scenemesh_find_stream(mesh, ds->usage, ds->set);
+        if(q >= 0 && ps >= 0 &&
+           mesh->vertexstreams[ps].valuetype == ds->valuetype &&
+           mesh->vertexstreams[ps].numcomponents == ds->numcomponents)
+        {
+            taa_scenemesh_quantization dsq = mesh->quantizations[q];
+            taa_scenemesh_rotate_quantized(ds, &dsq, dir);
+        }
+        else
+        {
+            taa_scenemesh_rotate_vertices(ds, dir, 0, ds->numvertices);
+        }
+    }
+    while(vsitr != vsend)
+    {
+        int32_t numcomps = vsitr->numcomponents;
+        int32_t numverts = vsitr->numvertices;
+        int32_t fixvs = 0;
+        int q;
+        switch(vsitr->usage)
+        {
+        case taa_SCENEMESH_USAGE_BINORMAL:    fixvs = 1; break;
+        case taa_SCENEMESH_USAGE_BLENDINDEX:  fixvs = 0; break;
+        case taa_SCENEMESH_USAGE_BLENDWEIGHT: fixvs = 0; break;
+        case taa_SCENEMESH_USAGE_COLOR:       fixvs = 0; break;
+        case taa_SCENEMESH_USAGE_FOG:         fixvs = 0; break;
+        case taa_SCENEMESH_USAGE_NORMAL:      fixvs = 1; break;
+        case taa_SCENEMESH_USAGE_POINTSIZE:   fixvs = 0; break;
+        case taa_SCENEMESH_USAGE_POSITION:    fixvs = 1; break;
+        case taa_SCENEMESH_USAGE_TANGENT:     fixvs = 1; break;
+        case taa_SCENEMESH_USAGE_TEXCOORD:    fixvs = 0; break;
+        case taa_SCENEMESH_USAGE_MERGED:      fixvs = 0; break;
+        }
+        q = taa_scenemesh_find_quantization(mesh,vsitr->usage,vsitr->set);
+        if(fixvs && q >= 0)
+        {
+            taa_scenemesh_rotate_quantized(vsitr, mesh->quantizations+q, dir);
+            if(vsitr->vertexhash != NULL)
+            {
+                taa_scenemesh_rehash_vertices(vsitr);
+            }
+        }
+        else if(fixvs && (numcomps >= 3))
+        {
+            taa_scenemesh_rotate_vertices(vsitr, dir, 0, numverts);
+            if(vsitr->vertexhash != NULL)
+            {
+                taa_scenemesh_rehash_vertices(vsitr);
+            }
+        }
+        ++vsitr;
+    }
+    // fix cached bounds
+    taa_scenemesh_rotate_bounds(&mesh->bounds, dir);
+    for(i = 0; i < mesh->numbindings; ++i)
+    {
+        taa_scenemesh_rotate_bounds(&mesh->bindings[i].bounds, dir);
+    }
+    // fix inverse bind matrices
+    taa_mat44_pitch(dir * taa_radians(90.0f), &pitch);
+    taa_mat44_transpose(&pitch, &invpitch);
+    while(jointitr != jointend)
+    {
+        taa_mat44 m;
+        taa_mat44_multiply(&invpitch, &jointitr->invbindmatrix, &m);
+        taa_mat44_multiply(&m, &pitch, &jointitr->invbindmatrix);
+        ++jointitr;
+    }
+}
+
+//****************************************************************************
+void taa_scenemesh_rotate_vertices(
+    taa_scenemesh_stream* vs,
+    int32_t dir,
+    uint32_t firstvertex,
+    uint32_t numvertices)
+{
+    // stride in components rather than bytes
+    uint32_t stride;
+    uint8_t* first;
+    assert(vs->numcomponents >= 3);
+    assert(firstvertex + numvertices <= vs->numvertices);
+    if(vs->valuetype == taa_SCENEMESH_VALUE_MERGED)
+    {
+        return;
+    }
+    stride = vs->stride / taa_scenemesh_calc_stride(vs->valuetype, 1);
+    first = vs->buffer + firstvertex * vs->stride;
+    // rotate Y and Z components
+    switch(vs->valuetype)
+    {
+    case taa_SCENEMESH_VALUE_FLOAT32:
+        {
+            float* vitr = (float*) first;
+            float* vend = vitr + (numvertices * stride);
+            float fdir = (float) dir;
+#ifdef taa_SCENEMESH_SSE
+            vitr += stride * taa_scenemesh_rotate_f32(
+                vitr,
+                numvertices,
+                stride,
+                dir);
+#endif
+            while(vitr != vend)
+            {
+                float tmp = vitr[1];
+                vitr[1] = fdir * vitr[2];
+                vitr[2] = fdir * -tmp;
+                vitr += stride;
+            }
+        }
+        break;
+    case taa_SCENEMESH_VALUE_FLOAT64:
+        {
+            double* vitr = (double*) first;
+            double* vend = vitr + (numvertices * stride);
+            double fdir = (double) dir;
+#ifdef taa_SCENEMESH_SSE2
+            vitr += stride * taa_scenemesh_rotate_f64(
+                vitr,
+                numvertices,
+                stride,
+                dir);
+#endif
+            while(vitr != vend)
+            {
+                double tmp = vitr[1];
+                vitr[1] = fdir * vitr[2];
+                vitr[2] = fdir * -tmp;
+                vitr += stride;
+            }
+        }
+        break;
+    case taa_SCENEMESH_VALUE_FLOAT16:
+        {
+            // negate by flipping the sign bit
+            uint16_t* vitr = (uint16_t*) first;
+            uint16_t* vend = vitr + (numvertices * stride);
+            uint16_t ysign = (uint16_t) ((dir < 0) ? 0x8000 : 0);
+            uint16_t zsign = (uint16_t) ((dir < 0) ? 0 : 0x8000);
+#ifdef taa_SCENEMESH_SSE2
+            vitr += stride * taa_scenemesh_rotate_i16x4(
+                vitr,
+                numvertices,
+                stride,
+                dir,
+                1);
+#endif
+            while(vitr != vend)
+            {
+                uint16_t tmp = vitr[1];
+                vitr[1] = vitr[2] ^ ysign;
+                vitr[2] = tmp ^ zsign;
+                vitr += stride;
+            }
+        }
+        break;
+    case taa_SCENEMESH_VALUE_INT8:
+    case taa_SCENEMESH_VALUE_UINT8:
+    case taa_SCENEMESH_VALUE_SNORM8:
+    case taa_SCENEMESH_VALUE_UNORM8:
+        {
+            int8_t* vitr = (int8_t*) first;
+            int8_t* vend = vitr + (numvertices * stride);
+            while(vitr != vend)
+            {
+                // negating -128 does not fit, so it saturates to 127
+                int32_t y = dir * vitr[2];
+                int32_t z = dir * -vitr[1];
+                vitr[1] = (int8_t) ((y > 127) ? 127 : y);
+                vitr[2] = (int8_t) ((z > 127) ? 127 : z);
+                vitr += stride;
+            }
+        }
+        break;
+    case taa_SCENEMESH_VALUE_INT16:
+    case taa_SCENEMESH_VALUE_UINT16:
+    case taa_SCENEMESH_VALUE_SNORM16:
+    case taa_SCENEMESH_VALUE_UNORM16:
+        {
+            int16_t* vitr = (int16_t*) first;
+            int16_t* vend = vitr + (numvertices * stride);
+#ifdef taa_SCENEMESH_SSE2
+            vitr += stride * taa_scenemesh_rotate_i16x4(
+                (uint16_t*) vitr,
+                numvertices,
+                stride,
+                dir,
+                0);
+#endif
+            while(vitr != vend)
+            {
+                // negating -32768 does not fit, so it saturates to 32767
+                int32_t y = dir * vitr[2];
+                int32_t z = dir * -vitr[1];
+                vitr[1] = (int16_t) ((y > 32767) ? 32767 : y);
+                vitr[2] = (int16_t) ((z > 32767) ? 32767 : z);
+                vitr += stride;
+            }
+        }
+        break;
+    case taa_SCENEMESH_VALUE_INT32:
+    case taa_SCENEMESH_VALUE_UINT32:
+        {
+            int32_t* vitr = (int32_t*) first;
+            int32_t* vend = vitr + (numvertices * stride);
+            while(vitr != vend)
+            {
+                int32_t tmp = vitr[1];
+                vitr[1] = (int32_t) (dir * vitr[2]);
+                vitr[2] = (int32_t) (dir * -tmp);
+                vitr += stride;
+            }
+        }
+        break;
+    case taa_SCENEMESH_VALUE_MERGED:
+        break;
+    }
+}
+
+//****************************************************************************
+void taa_scenemesh_shrink_to_fit(
+    taa_scenemesh* mesh)
+{
+    taa_scenemesh_stream* vsitr = mesh->vertexstreams;
+    taa_scenemesh_stream* vsend = vsitr + mesh->numstreams;
+    while(vsitr != vsend)
+    {
+        taa_scenemesh_shrink_stream(vsitr);
+        ++vsitr;
+    }
+    taa_scenemesh_shrink_stream(&mesh->depthstream);
+}
+
+//****************************************************************************
+void taa_scenemesh_simplify(
+    taa_scenemesh* mesh,
+    const float* ratios,
+    uint32_t numlevels,
+    float maxerror)
+{
+    int32_t posvs;
+    uint32_t numverts;
+    uint32_t numpos;
+    uint32_t numtris;
+    uint32_t origtris;
+    uint32_t hashsize;
+    uint32_t edgemask;
+    uint32_t level;
+    uint32_t* tris;
+    uint32_t* bindtris;
+    uint32_t* vertpos;
+    uint32_t* vertremap;
+    uint32_t* wedgemap;
+    uint32_t* posbinding;
+    uint32_t* postrioffsets;
+    uint32_t* postris;
+    uint64_t* edgekeys;
+    uint32_t* edgecounts;
+    uint8_t* poslocked;
+    uint8_t* posborder;
+    float* positions;
+    float* points;
+    taa_scenemesh_quadric* quadrics;
+    taa_scenemesh_collapse* collapses;
+    float limit;
+    float error;
+    uint32_t i;
+    uint32_t j;
+
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    // the mesh must be triangulated with merged indices
+    assert(mesh->indexsize == 1);
+    mesh->numlods = 0;
+    mesh->numlodindices = 0;
+    posvs = taa_scenemesh_find_stream(mesh, taa_SCENEMESH_USAGE_POSITION, 0);
+    if(posvs < 0 || mesh->numfaces == 0)
+    {
+        // nothing to measure the error with
+        return;
+    }
+    // edges are collapsed onto one of their end points in order of quadric
+    // error, so every level references the existing vertices, and each
+    // level continues from the previous one. positions shared by bindings
+    // never move, and open borders only collapse along themselves.
+    numverts = taa_scenemesh_calc_numindexed(mesh);
+    assert(numverts <= mesh->vertexstreams[posvs].numvertices);
+    positions = taa_scenemesh_read_positions(mesh, posvs);
+
+    // vertices split by other attributes share a position id
+    vertpos = (uint32_t*) malloc(numverts * sizeof(*vertpos));
+    points = (float*) malloc(numverts * 3 * sizeof(*points));
+    numpos = taa_scenemesh_weld_positions(positions,numverts,vertpos,points);
+    free(positions);
+
+    // gather the triangles of every binding, dropping degenerate ones, and
+    // lock the positions shared by more than one binding
+    tris = (uint32_t*) malloc(mesh->numfaces * 3 * sizeof(*tris));
+    bindtris = (uint32_t*) malloc(mesh->numbindings * sizeof(*bindtris));
+    posbinding = (uint32_t*) malloc(numpos * sizeof(*posbinding));
+    poslocked = (uint8_t*) calloc(numpos, sizeof(*poslocked));
+    memset(posbinding, 0xff, numpos * sizeof(*posbinding));
+    numtris = 0;
+    for(i = 0; i < mesh->numbindings; ++i)
+    {
+        uint32_t* bindstart = tris + numtris*3;
+        uint32_t* titr = bindstart;
+        uint32_t* tend = titr + mesh->bindings[i].numfaces*3;
+        uint32_t* tdst = bindstart;
+        taa_scenemesh_gather_tris(mesh, mesh->bindings + i, bindstart);
+        while(titr != tend)
+        {
+            uint32_t p0 = vertpos[titr[0]];
+            uint32_t p1 = vertpos[titr[1]];
+            uint32_t p2 = vertpos[titr[2]];
+            if(p0 != p1 && p0 != p2 && p1 != p2)
+            {
+                for(j = 0; j < 3; ++j)
+                {
+                    uint32_t pos = vertpos[titr[j]];
+                    poslocked[pos] |= (posbinding[pos] != ~0U &&
+                                       posbinding[pos] != i);
+                    posbinding[pos] = i;
+                    tdst[j] = titr[j];
+                }
+                tdst += 3;
+            }
+            titr += 3;
+        }
+        bindtris[i] = (uint32_t) ((tdst - bindstart) / 3);
+        numtris += bindtris[i];
+    }
+    free(posbinding);
+    origtris = numtris;
+
+    hashsize = 16;
+    while(hashsize < numtris * 6)
+    {
+        hashsize <<= 1;
+    }
+    edgemask = hashsize - 1;
+    edgekeys = (uint64_t*) malloc(hashsize * sizeof(*edgekeys));
+    edgecounts = (uint32_t*) malloc(hashsize * sizeof(*edgecounts));
+    posborder = (uint8_t*) malloc(numpos * sizeof(*posborder));
+    vertremap = (uint32_t*) malloc(numverts * sizeof(*vertremap));
+    wedgemap = (uint32_t*) malloc(numverts * sizeof(*wedgemap));
+    postrioffsets = (uint32_t*) malloc((numpos+1) * sizeof(*postrioffsets));
+    postris = (uint32_t*) malloc(numtris * 3 * sizeof(*postris));
+    collapses = (taa_scenemesh_collapse*) malloc(
+        hashsize * 2 * sizeof(*collapses));
+    quadrics = (taa_scenemesh_quadric*) calloc(numpos, sizeof(*quadrics));
+    memset(vertremap, 0xff, numverts * sizeof(*vertremap));
+    memset(wedgemap, 0xff, numverts * sizeof(*wedgemap));
+
+    // accumulate the area weighted planes of the triangles, and planes
+    // perpendicular to the open borders to keep their shape
+    taa_scenemesh_update_edges(
+        tris,
+        numtris,
+        vertpos,
+        edgekeys,
+        edgecounts,
+        edgemask);
+    for(i = 0; i < numtris; ++i)
+    {
+        const uint32_t* t = tris + i*3;
+        float n[3];
+        float len;
+        taa_scenemesh_calc_tri_normal(
+            points + vertpos[t[0]]*3,
+            points + vertpos[t[1]]*3,
+            points + vertpos[t[2]]*3,
+            n);
+        len = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        if(len > 0.0f)
+        {
+            n[0] /= len;
+            n[1] /= len;
+            n[2] /= len;
+            for(j = 0; j < 3; ++j)
+            {
+                uint32_t pa = vertpos[t[j]];
+                uint32_t pb = vertpos[t[(j + 1) % 3]];
+                const float* a = points + pa*3;
+                const float* b = points + pb*3;
+                float d = -(n[0]*a[0] + n[1]*a[1] + n[2]*a[2]);
+                taa_scenemesh_add_quadric(quadrics+pa, n, d, len*0.5f);
+                if(edgecounts[taa_scenemesh_probe_edge(
+                    edgekeys,
+                    edgemask,
+                    pa,
+                    pb)] == 1)
+                {
+                    float e[3];
+                    float bn[3];
+                    float elen;
+                    e[0] = b[0] - a[0];
+                    e[1] = b[1] - a[1];
+                    e[2] = b[2] - a[2];
+                    bn[0] = e[1]*n[2] - e[2]*n[1];
+                    bn[1] = e[2]*n[0] - e[0]*n[2];
+                    bn[2] = e[0]*n[1] - e[1]*n[0];
+                    elen = sqrtf(bn[0]*bn[0] + bn[1]*bn[1] + bn[2]*bn[2]);
+                    if(elen > 0.0f)
+                    {
+                        bn[0] /= elen;
+                        bn[1] /= elen;
+                        bn[2] /= elen;
+                        d = -(bn[0]*a[0] + bn[1]*a[1] + bn[2]*a[2]);
+                        elen *= elen * 10.0f;
+                        taa_scenemesh_add_quadric(quadrics+pa, bn, d, elen);
+                        taa_scenemesh_add_quadric(quadrics+pb, bn, d, elen);
+                    }
+                }
+            }
+        }
+    }
+
+    limit = maxerror * maxerror;
+    error = 0.0f;
+    for(level = 0; level < numlevels; ++level)
+    {
+        uint32_t target = (uint32_t) (ratios[level] * origtris);
+        uint32_t firstindex;
+        while(numtris > target)
+        {
+            uint32_t numcollapses = 0;
+            uint32_t numremoved = 0;
+            uint32_t numcollapsed = 0;
+            uint32_t* tdst;
+            const uint32_t* tsrc;
+
+            // build the list of triangles using each position
+            memset(postrioffsets, 0, (numpos+1) * sizeof(*postrioffsets));
+            for(i = 0; i < numtris * 3; ++i)
+            {
+                ++postrioffsets[vertpos[tris[i]] + 1];
+            }
+            for(i = 0; i < numpos; ++i)
+            {
+                postrioffsets[i + 1] += postrioffsets[i];
+            }
+            for(i = 0; i < numtris * 3; ++i)
+            {
+                postris[postrioffsets[vertpos[tris[i]]]++] = i / 3;
+            }
+            for(i = numpos; i > 0; --i)
+            {
+                postrioffsets[i] = postrioffsets[i - 1];
+            }
+            postrioffsets[0] = 0;
+
+            // find the open borders, and lock non-manifold edges. locks are
+            // stored in bit 1, above the permanent binding locks.
+            taa_scenemesh_update_edges(
+                tris,
+                numtris,
+                vertpos,
+                edgekeys,
+                edgecounts,
+                edgemask);
+            memset(posborder, 0, numpos * sizeof(*posborder));
+            for(i = 0; i < numpos; ++i)
+            {
+                poslocked[i] &= 1;
+            }
+            for(i = 0; i <= edgemask; ++i)
+            {
+                if(edgekeys[i] != ~((uint64_t) 0))
+                {
+                    uint32_t a = (uint32_t) (edgekeys[i] >> 32);
+                    uint32_t b = (uint32_t) edgekeys[i];
+                    if(edgecounts[i] == 1)
+                    {
+                        posborder[a] = 1;
+                        posborder[b] = 1;
+                    }
+                    else if(edgecounts[i] > 2)
+                    {
+                        poslocked[a] |= 2;
+                        poslocked[b] |= 2;
+                    }
+                }
+            }
+
+            // collect the candidate collapses in both directions of every
+            // edge. border positions may only move along the border.
+            for(i = 0; i <= edgemask; ++i)
+            {
+                if(edgekeys[i] != ~((uint64_t) 0))
+                {
+                    uint32_t ends[2];
+                    ends[0] = (uint32_t) (edgekeys[i] >> 32);
+                    ends[1] = (uint32_t) edgekeys[i];
+                    for(j = 0; j < 2; ++j)
+                    {
+                        uint32_t from = ends[j];
+                        uint32_t to = ends[1 - j];
+                        float cost;
+                        if(poslocked[from] ||
+                           (posborder[from] && edgecounts[i] != 1))
+                        {
+                            continue;
+                        }
+                        cost = taa_scenemesh_eval_quadric(
+                            quadrics + from,
+                            points + to*3);
+                        if(cost <= limit)
+                        {
+                            collapses[numcollapses].cost = cost;
+                            collapses[numcollapses].from = from;
+                            collapses[numcollapses].to = to;
+                            ++numcollapses;
+                        }
+                    }
+                }
+            }
+            qsort(
+                collapses,
+                numcollapses,
+                sizeof(*collapses),
+                taa_scenemesh_cmp_collapse);
+
+            // perform the cheapest collapses. the positions around each
+            // collapse are locked for the rest of the pass, so the
+            // adjacency of any unlocked position stays valid.
+            for(i = 0; i < numcollapses; ++i)
+            {
+                const taa_scenemesh_collapse* c = collapses + i;
+                const uint32_t* titr;
+                const uint32_t* tend;
+                if(numtris - numremoved <= target)
+                {
+                    break;
+                }
+                if(poslocked[c->from] || (poslocked[c->to] & 2))
+                {
+                    continue;
+                }
+                if(!taa_scenemesh_check_collapse(
+                    tris,
+                    vertpos,
+                    points,
+                    postris,
+                    postrioffsets,
+                    c->from,
+                    c->to,
+                    wedgemap))
+                {
+                    continue;
+                }
+                titr = postris + postrioffsets[c->from];
+                tend = postris + postrioffsets[c->from + 1];
+                while(titr != tend)
+                {
+                    const uint32_t* t = tris + (*titr)*3;
+                    uint32_t numto = 0;
+                    for(j = 0; j < 3; ++j)
+                    {
+                        uint32_t pos = vertpos[t[j]];
+                        if(pos == c->from)
+                        {
+                            vertremap[t[j]] = wedgemap[t[j]];
+                        }
+                        numto += (pos == c->to);
+                        poslocked[pos] |= 2;
+                    }
+                    numremoved += numto;
+                    ++titr;
+                }
+                titr = postris + postrioffsets[c->from];
+                while(titr != tend)
+                {
+                    const uint32_t* t = tris + (*titr)*3;
+                    wedgemap[t[0]] = ~0U;
+                    wedgemap[t[1]] = ~0U;
+                    wedgemap[t[2]] = ~0U;
+                    ++titr;
+                }
+                taa_scenemesh_merge_quadric(
+                    quadrics + c->to,
+                    quadrics + c->from);
+                error = (c->cost > error) ? c->cost : error;
+                ++numcollapsed;
+            }
+            if(numcollapsed == 0)
+            {
+                // nothing more can be removed within the error limit
+                break;
+            }
+
+            // remap the collapsed vertices and remove the triangles that
+            // became degenerate, keeping the triangles grouped by binding
+            tsrc = tris;
+            tdst = tris;
+            numtris = 0;
+            for(i = 0; i < mesh->numbindings; ++i)
+            {
+                const uint32_t* tend = tsrc + bindtris[i]*3;
+                uint32_t* bindstart = tdst;
+                while(tsrc != tend)
+                {
+                    uint32_t v0 = tsrc[0];
+                    uint32_t v1 = tsrc[1];
+                    uint32_t v2 = tsrc[2];
+                    v0 = (vertremap[v0] != ~0U) ? vertremap[v0] : v0;
+                    v1 = (vertremap[v1] != ~0U) ? vertremap[v1] : v1;
+                    v2 = (vertremap[v2] != ~0U) ? vertremap[v2] : v2;
+                    if(vertpos[v0] != vertpos[v1] &&
+                       vertpos[v0] != vertpos[v2] &&
+                       vertpos[v1] != vertpos[v2])
+                    {
+                        tdst[0] = v0;
+                        tdst[1] = v1;
+                        tdst[2] = v2;
+                        tdst += 3;
+                    }
+                    tsrc += 3;
+                }
+                bindtris[i] = (uint32_t) ((tdst - bindstart) / 3);
+                numtris += bindtris[i];
+            }
+            memset(vertremap, 0xff, numverts * sizeof(*vertremap));
         }
-        face += oldnum;
-        memset(face, 0, (numfaces-oldnum) * sizeof(*face));
-    }
-    mesh->numfaces = numfaces;
-}
 
-//****************************************************************************
-void taa_scenemesh_resize_indices(
-    taa_scenemesh* mesh,
-    uint32_t numindices)
-{
-    uint32_t oldnum = mesh->numindices;
-    uint32_t* indices = mesh->indices;
-    if(numindices > oldnum)
-    {
-        uint32_t cap = (oldnum     + 1023) & ~1023;
-        uint32_t ncap= (numindices + 1023) & ~1023;
-        if(cap != ncap)
+        // store the triangles of each binding for this level
+        firstindex = mesh->numlodindices;
+        taa_scenemesh_resize_lods(
+            mesh,
+            mesh->numlods + mesh->numbindings,
+            firstindex + numtris*3);
+        memcpy(
+            mesh->lodindices + firstindex,
+            tris,
+            numtris * 3 * sizeof(*tris));
+        for(i = 0; i < mesh->numbindings; ++i)
         {
-            // realloc the face buffer to nearest 1k capacity
-            indices = (uint32_t*) realloc(
-                indices,
-                ncap * sizeof(*indices));
-            mesh->indices = indices;
+            taa_scenemesh_lod* lod;
+            lod = mesh->lods + (mesh->numlods - mesh->numbindings + i);
+            lod->level = level + 1;
+            lod->binding = i;
+            lod->firstindex = firstindex;
+            lod->numindices = bindtris[i] * 3;
+            lod->error = sqrtf(error);
+            firstindex += lod->numindices;
         }
-        indices += oldnum;
-        memset(indices, 0, (numindices-oldnum) * sizeof(*indices));
     }
-    mesh->numindices = numindices;
+    free(quadrics);
+    free(collapses);
+    free(postris);
+    free(postrioffsets);
+    free(wedgemap);
+    free(vertremap);
+    free(posborder);
+    free(edgecounts);
+    free(edgekeys);
+    free(poslocked);
+    free(bindtris);
+    free(tris);
+    free(points);
+    free(vertpos);
 }
 
 //****************************************************************************
-void taa_scenemesh_resize_skinjoints(
+void taa_scenemesh_skin(
     taa_scenemesh* mesh,
-    uint32_t numjoints)
+    const taa_mat44* palette,
+    uint32_t firstvertex,
+    uint32_t numvertices,
+    float* positions_out,
+    float* normals_out)
 {
-    uint32_t oldnum = mesh->numjoints;
-    taa_scenemesh_skinjoint* joint = mesh->joints;
-    uint32_t cap = (oldnum   +31) & ~31;
-    uint32_t ncap= (numjoints+31) & ~31;
-    if(cap != ncap)
+    int32_t posvs;
+    int32_t normvs;
+    int32_t indexvs;
+    int32_t weightvs;
+    const taa_scenemesh_quantization* posq = NULL;
+    const taa_scenemesh_quantization* normq = NULL;
+    const taa_scenemesh_stream* pvs;
+    const taa_scenemesh_stream* nvs = NULL;
+    const taa_scenemesh_stream* ivs;
+    const taa_scenemesh_stream* wvs;
+    uint32_t numinfluences;
+    uint32_t i;
+    int q;
+
+    assert(mesh->indexsize == 1); // indices must be merged
+    // the streams with set 0 are blended by up to
+    // taa_SCENEMESH_MAXINFLUENCES joints per vertex. the blend indices
+    // reference mesh->joints directly, and the mesh is only read.
+    posvs = taa_scenemesh_find_stream(
+        mesh,
+        taa_SCENEMESH_USAGE_POSITION,
+        0);
+    normvs = taa_scenemesh_find_stream(
+        mesh,
+        taa_SCENEMESH_USAGE_NORMAL,
+        0);
+    indexvs = taa_scenemesh_find_stream(
+        mesh,
+        taa_SCENEMESH_USAGE_BLENDINDEX,
+        0);
+    weightvs = taa_scenemesh_find_stream(
+        mesh,
+        taa_SCENEMESH_USAGE_BLENDWEIGHT,
+        0);
+    assert(posvs >= 0 && indexvs >= 0 && weightvs >= 0);
+    assert(normvs >= 0 || normals_out == NULL);
+    pvs = mesh->vertexstreams + posvs;
+    ivs = mesh->vertexstreams + indexvs;
+    wvs = mesh->vertexstreams + weightvs;
+    q = taa_scenemesh_find_quantization(mesh,taa_SCENEMESH_USAGE_POSITION,0);
+    if(q >= 0)
     {
-        joint = (taa_scenemesh_skinjoint*) taa_scenemesh_aligned_realloc(
-            joint,
-            16,
-            cap * sizeof(*joint),
-            ncap * sizeof(*joint));
-        mesh->joints = joint;
+        posq = mesh->quantizations + q;
     }
-    if(numjoints > oldnum)
+    if(normals_out != NULL)
     {
-        joint += oldnum;
-        memset(joint, 0, (numjoints-oldnum) * sizeof(*joint));
+        nvs = mesh->vertexstreams + normvs;
+        q = taa_scenemesh_find_quantization(
+            mesh,
+            taa_SCENEMESH_USAGE_NORMAL,
+            0);
+        if(q >= 0)
+        {
+            normq = mesh->quantizations + q;
+        }
     }
-    mesh->numjoints = numjoints;
-}
+    numinfluences = ivs->numcomponents;
+    if(wvs->numcomponents < numinfluences)
+    {
+        numinfluences = wvs->numcomponents;
+    }
+    assert(numinfluences <= taa_SCENEMESH_MAXINFLUENCES);
+    assert(firstvertex + numvertices <= pvs->numvertices);
 
-//****************************************************************************
-void taa_scenemesh_resize_streams(
-    taa_scenemesh* mesh,
-    uint32_t numstreams)
-{
-    uint32_t oldnum = mesh->numstreams;
-    taa_scenemesh_stream* vs = mesh->vertexstreams;
-    if(numstreams > oldnum)
+    for(i = 0; i < numvertices; ++i)
     {
-        uint32_t cap = (oldnum    +7) & ~7;
-        uint32_t ncap= (numstreams+7) & ~7;
-        if(cap != ncap)
+        uint32_t vertex = firstvertex + i;
+        uint32_t joints[taa_SCENEMESH_MAXINFLUENCES];
+        float weights[taa_SCENEMESH_MAXINFLUENCES];
+        float jointvals[taa_SCENEMESH_MAXINFLUENCES];
+        float p[3];
+        float n[3];
+        uint32_t numweights = 0;
+        uint32_t j;
+        taa_scenemesh_read_floats(ivs, vertex, jointvals, numinfluences);
+        taa_scenemesh_read_floats(wvs, vertex, weights, numinfluences);
+        for(j = 0; j < numinfluences; ++j)
         {
-            vs = (taa_scenemesh_stream*) realloc(vs, ncap * sizeof(*vs));
-            mesh->vertexstreams = vs;
+            // skip unused influences
+            uint32_t joint = (uint32_t) jointvals[j];
+            assert(weights[j] == 0.0f || joint < mesh->numjoints);
+            if(weights[j] != 0.0f && joint < mesh->numjoints)
+            {
+                joints[numweights] = joint;
+                weights[numweights] = weights[j];
+                ++numweights;
+            }
         }
-        vs += oldnum;
-        memset(vs, 0, (numstreams-oldnum) * sizeof(*vs));
+        taa_scenemesh_read_vector(pvs, posq, vertex, p);
+        if(nvs != NULL)
+        {
+            taa_scenemesh_read_vector(nvs, normq, vertex, n);
+        }
+        taa_scenemesh_skin_vertex(
+            palette,
+            joints,
+            weights,
+            numweights,
+            p,
+            (nvs != NULL) ? n : NULL,
+            positions_out + i*3,
+            (nvs != NULL) ? normals_out + i*3 : NULL);
     }
-    mesh->numstreams = numstreams;
 }
 
 //****************************************************************************
-void taa_scenemesh_resize_vertices(
-    taa_scenemesh_stream* vs,
-    uint32_t stride,
-    uint32_t numverts)
+void taa_scenemesh_split_palettes(
+    taa_scenemesh* mesh,
+    uint32_t maxjoints)
 {
-    uint32_t oldsz = vs->stride * vs->numvertices;
-    uint32_t newsz = stride * numverts;
-    // round to nearest mb
-    uint32_t ocap = (oldsz + (1024*1024-1)) & ~(1024*1024-1);
-    uint32_t ncap = (newsz + (1024*1024-1)) & ~(1024*1024-1);
-    if(ocap != ncap)
+    int32_t indexvs;
+    int32_t weightvs;
+    taa_scenemesh_stream* ivs;
+    taa_scenemesh_stream* wvs;
+    taa_scenemesh_binding* bindings;
+    uint32_t numbindings = 0;
+    uint32_t bindingcap;
+    uint32_t numinfluences;
+    uint32_t numverts;
+    uint32_t compsize;
+    uint32_t valuesize;
+    uint32_t maxstride = 0;
+    // global joint of each influence of each vertex, ~0 if unused
+    uint32_t* vertjoints;
+    // first new binding to write the blend indices of each vertex
+    uint32_t* vertowner;
+    // last new binding to reference each vertex, and the vertex used there
+    uint32_t* vertstamp;
+    uint32_t* vertcopy;
+    // palette offset of each joint in the current palette, or ~0
+    uint32_t* jointslots;
+    uint32_t* palette;
+    uint32_t numpalette = 0;
+    uint8_t* localbuf;
+    uint8_t* vertbuf;
+    uint32_t i;
+    uint32_t b;
+
+    assert(mesh->indexsize == 1); // indices must be merged
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    assert(mesh->numpalettejoints == 0); // already split
+    indexvs = taa_scenemesh_find_stream(
+        mesh,
+        taa_SCENEMESH_USAGE_BLENDINDEX,
+        0);
+    weightvs = taa_scenemesh_find_stream(
+        mesh,
+        taa_SCENEMESH_USAGE_BLENDWEIGHT,
+        0);
+    if(indexvs < 0 || weightvs < 0)
     {
-        uint8_t* buf = vs->buffer;    
-        buf = (uint8_t*) taa_scenemesh_aligned_realloc(buf, 16, ocap, ncap);
-        vs->buffer = buf;
+        return;
+    }
+    ivs = mesh->vertexstreams + indexvs;
+    wvs = mesh->vertexstreams + weightvs;
+    numverts = ivs->numvertices;
+    numinfluences = ivs->numcomponents;
+    if(wvs->numcomponents < numinfluences)
+    {
+        numinfluences = wvs->numcomponents;
+    }
+    assert(numinfluences <= taa_SCENEMESH_MAXINFLUENCES);
+    compsize = taa_scenemesh_calc_stride(ivs->valuetype, 1);
+    valuesize = compsize * ivs->numcomponents;
+    for(i = 0; i < mesh->numstreams; ++i)
+    {
+        if(mesh->vertexstreams[i].stride > maxstride)
+        {
+            maxstride = mesh->vertexstreams[i].stride;
+        }
     }
-    vs->stride = stride;
-    vs->numvertices = numverts;
-}
 
-//****************************************************************************
-void taa_scenemesh_rotate_upaxis(
-    taa_scenemesh* mesh,
-    int32_t dir)
-{
-    taa_scenemesh_skinjoint* jointitr = mesh->joints;
-    taa_scenemesh_skinjoint* jointend = jointitr + mesh->numjoints;
-    taa_scenemesh_stream* vsitr = mesh->vertexstreams;
-    taa_scenemesh_stream* vsend = vsitr + mesh->numstreams;
-    taa_mat44 pitch;
-    taa_mat44 invpitch;
-    while(vsitr != vsend)
+    bindingcap = mesh->numbindings + 8;
+    bindings = (taa_scenemesh_binding*) malloc(bindingcap*sizeof(*bindings));
+    vertjoints = (uint32_t*) malloc(
+        (numverts*numinfluences + 1) * sizeof(*vertjoints));
+    vertowner = (uint32_t*) malloc((numverts + 1) * sizeof(*vertowner));
+    vertstamp = (uint32_t*) malloc((numverts + 1) * sizeof(*vertstamp));
+    vertcopy = (uint32_t*) malloc((numverts + 1) * sizeof(*vertcopy));
+    jointslots = (uint32_t*) malloc((mesh->numjoints+1)*sizeof(*jointslots));
+    palette = (uint32_t*) malloc((mesh->numjoints + 1) * sizeof(*palette));
+    localbuf = (uint8_t*) malloc(valuesize + 1);
+    vertbuf = (uint8_t*) malloc(maxstride + 1);
+    memset(vertowner, 0xff, numverts * sizeof(*vertowner));
+    memset(vertstamp, 0xff, numverts * sizeof(*vertstamp));
+    memset(jointslots, 0xff, mesh->numjoints * sizeof(*jointslots));
+
+    // gather the joints of each vertex
+    for(i = 0; i < numverts; ++i)
     {
-        int32_t numcomps = vsitr->numcomponents;
-        int32_t numverts = vsitr->numvertices;
-        int32_t fixvs = 0;
-        switch(vsitr->usage)
+        float jointvals[taa_SCENEMESH_MAXINFLUENCES];
+        float weights[taa_SCENEMESH_MAXINFLUENCES];
+        uint32_t* vj = vertjoints + i*numinfluences;
+        uint32_t j;
+        taa_scenemesh_read_floats(ivs, i, jointvals, numinfluences);
+        taa_scenemesh_read_floats(wvs, i, weights, numinfluences);
+        for(j = 0; j < numinfluences; ++j)
         {
-        case taa_SCENEMESH_USAGE_BINORMAL:    fixvs = 1; break;
-        case taa_SCENEMESH_USAGE_BLENDINDEX:  fixvs = 0; break;
-        case taa_SCENEMESH_USAGE_BLENDWEIGHT: fixvs = 0; break;
-        case taa_SCENEMESH_USAGE_COLOR:       fixvs = 0; break;
-        case taa_SCENEMESH_USAGE_FOG:         fixvs = 0; break;
-        case taa_SCENEMESH_USAGE_NORMAL:      fixvs = 1; break;
-        case taa_SCENEMESH_USAGE_POINTSIZE:   fixvs = 0; break;
-        case taa_SCENEMESH_USAGE_POSITION:    fixvs = 1; break;
-        case taa_SCENEMESH_USAGE_TANGENT:     fixvs = 1; break;
-        case taa_SCENEMESH_USAGE_TEXCOORD:    fixvs = 0; break;
-        case taa_SCENEMESH_USAGE_MERGED:      fixvs = 0; break;
+            vj[j] = ~0U;
+            if(weights[j] != 0.0f)
+            {
+                vj[j] = (uint32_t) jointvals[j];
+                assert(vj[j] < mesh->numjoints);
+            }
         }
-        if(fixvs && (numcomps >= 3))
+    }
+
+    for(b = 0; b < mesh->numbindings; ++b)
+    {
+        const taa_scenemesh_binding* bind = mesh->bindings + b;
+        uint32_t firstface = bind->firstface;
+        uint32_t faceend = bind->firstface + bind->numfaces;
+        uint32_t f = firstface;
+        while(1)
         {
-            // rotate Y and Z components
-            switch(vsitr->valuetype)
+            int full = 0;
+            if(f != faceend)
             {
-            case taa_SCENEMESH_VALUE_FLOAT32:
+                // add the joints of the face to the palette
+                const taa_scenemesh_face* face = mesh->faces + f;
+                const uint32_t* indexitr = mesh->indices + face->firstindex;
+                const uint32_t* indexend = indexitr + face->numindices;
+                uint32_t prevpalette = numpalette;
+                while(indexitr != indexend)
                 {
-                    float* vitr = (float*) vsitr->buffer;
-                    float* vend = vitr + (numverts * numcomps);
-                    float fdir = (float) dir;
-                    while(vitr != vend)
+                    const uint32_t* vj = vertjoints + *indexitr*numinfluences;
+                    uint32_t j;
+                    for(j = 0; j < numinfluences; ++j)
                     {
-                        float tmp = vitr[1];
-                        vitr[1] = fdir * vitr[2];
-                        vitr[2] = fdir * -tmp;
-                        vitr += numcomps;
+                        if(vj[j] != ~0U && jointslots[vj[j]] == ~0U)
+                        {
+                            jointslots[vj[j]] = numpalette;
+                            palette[numpalette] = vj[j];
+                            ++numpalette;
+                        }
                     }
+                    ++indexitr;
                 }
-                break;
-            case taa_SCENEMESH_VALUE_FLOAT64:
+                if(numpalette > maxjoints && f != firstface)
                 {
-                    double* vitr = (double*) vsitr->buffer;
-                    double* vend = vitr + (numverts * numcomps);
-                    double fdir = (double) dir;
-                    while(vitr != vend)
+                    // the face does not fit, so it starts the next palette
+                    while(numpalette > prevpalette)
                     {
-                        double tmp = vitr[1];
-                        vitr[1] = fdir * vitr[2];
-                        vitr[2] = fdir * -tmp;
-                        vitr += numcomps;
+                        --numpalette;
+                        jointslots[palette[numpalette]] = ~0U;
                     }
+                    full = 1;
                 }
-                break;
-            case taa_SCENEMESH_VALUE_INT8:
-            case taa_SCENEMESH_VALUE_UINT8:
+                assert(numpalette <= maxjoints); // face uses too many joints
+            }
+            if(f == faceend || full)
+            {
+                // emit the faces before f as a new binding
+                taa_scenemesh_binding* newbind;
+                uint32_t newb = numbindings;
+                uint32_t firstjoint = mesh->numpalettejoints;
+                uint32_t k;
+                if(numbindings == bindingcap)
                 {
-                    int8_t* vitr = (int8_t*) vsitr->buffer;
-                    int8_t* vend = vitr + (numverts * numcomps);
-                    while(vitr != vend)
-                    {
-                        int8_t tmp = vitr[1];
-                        vitr[1] = (int8_t) (dir * vitr[2]);
-                        vitr[2] = (int8_t) (dir * -tmp);
-                        vitr += numcomps;
-                    }
+                    bindingcap *= 2;
+                    bindings = (taa_scenemesh_binding*) realloc(
+                        bindings,
+                        bindingcap * sizeof(*bindings));
                 }
-                break;
-            case taa_SCENEMESH_VALUE_INT16:
-            case taa_SCENEMESH_VALUE_UINT16:
+                newbind = bindings + newb;
+                *newbind = *bind;
+                newbind->firstface = firstface;
+                newbind->numfaces = f - firstface;
+                newbind->firstpalettejoint = firstjoint;
+                newbind->numpalettejoints = numpalette;
+                ++numbindings;
+                taa_scenemesh_resize_palettejoints(mesh,firstjoint+numpalette);
+                memcpy(
+                    mesh->palettejoints + firstjoint,
+                    palette,
+                    numpalette * sizeof(*palette));
+                // rewrite the blend indices of the vertices of the faces
+                for(k = firstface; k != f; ++k)
                 {
-                    int16_t* vitr = (int16_t*) vsitr->buffer;
-                    int16_t* vend = vitr + (numverts * numcomps);
-                    while(vitr != vend)
+                    const taa_scenemesh_face* face = mesh->faces + k;
+                    uint32_t* indexitr = mesh->indices + face->firstindex;
+                    uint32_t* indexend = indexitr + face->numindices;
+                    while(indexitr != indexend)
                     {
-                        int16_t tmp = vitr[1];
-                        vitr[1] = (int16_t) (dir * vitr[2]);
-                        vitr[2] = (int16_t) (dir * -tmp);
-                        vitr += numcomps;
+                        uint32_t v = *indexitr;
+                        if(vertstamp[v] != newb)
+                        {
+                            const uint32_t* vj = vertjoints + v*numinfluences;
+                            uint8_t* src = ivs->buffer + v*ivs->stride;
+                            uint32_t c;
+                            for(c = 0; c < ivs->numcomponents; ++c)
+                            {
+                                uint32_t slot = 0;
+                                if(c < numinfluences && vj[c] != ~0U)
+                                {
+                                    slot = jointslots[vj[c]];
+                                }
+                                taa_scenemesh_encode_value(
+                                    ivs->valuetype,
+                                    (double) slot,
+                                    localbuf + c*compsize);
+                            }
+                            vertstamp[v] = newb;
+                            vertcopy[v] = v;
+                            if(vertowner[v] == ~0U)
+                            {
+                                vertowner[v] = newb;
+                                memcpy(src, localbuf, valuesize);
+                            }
+                            else if(memcmp(src, localbuf, valuesize) != 0)
+                            {
+                                // the vertex is used with another palette, so
+                                // duplicate it in every stream
+                                vertcopy[v] = taa_scenemesh_duplicate_vertex(
+                                    mesh,
+                                    v,
+                                    vertbuf);
+                                memcpy(
+                                    ivs->buffer + vertcopy[v]*ivs->stride,
+                                    localbuf,
+                                    valuesize);
+                            }
+                        }
+                        *indexitr = vertcopy[v];
+                        ++indexitr;
                     }
                 }
-                break;
-            case taa_SCENEMESH_VALUE_INT32:
-            case taa_SCENEMESH_VALUE_UINT32:
+                // start the next palette
+                while(numpalette > 0)
                 {
-                    int32_t* vitr = (int32_t*) vsitr->buffer;
-                    int32_t* vend = vitr + (numverts * numcomps);
-                    while(vitr != vend)
-                    {
-                        int32_t tmp = vitr[1];
-                        vitr[1] = (int32_t) (dir * vitr[2]);
-                        vitr[2] = (int32_t) (dir * -tmp);
-                        vitr += numcomps;
-                    }
+                    --numpalette;
+                    jointslots[palette[numpalette]] = ~0U;
+                }
+                firstface = f;
+                if(!full)
+                {
+                    break;
                 }
-                break;
-            case taa_SCENEMESH_VALUE_MERGED:
-                break;
+            }
+            else
+            {
+                ++f;
             }
         }
-        ++vsitr;
     }
-    // fix inverse bind matrices
-    taa_mat44_pitch(dir * taa_radians(90.0f), &pitch);
-    taa_mat44_transpose(&pitch, &invpitch);
-    while(jointitr != jointend)
+
+    // replace the bindings. the meshlets and lods reference the old
+    // bindings, so they are discarded.
+    taa_scenemesh_resize_bindings(mesh, numbindings);
+    memcpy(mesh->bindings, bindings, numbindings * sizeof(*bindings));
+    taa_scenemesh_resize_meshlets(mesh, 0, 0, 0);
+    taa_scenemesh_resize_lods(mesh, 0, 0);
+    if(ivs->vertexhash != NULL)
     {
-        taa_mat44 m;
-        taa_mat44_multiply(&invpitch, &jointitr->invbindmatrix, &m);
-        taa_mat44_multiply(&m, &pitch, &jointitr->invbindmatrix);
-        ++jointitr;
+        taa_scenemesh_rehash_vertices(ivs);
     }
+    free(vertbuf);
+    free(localbuf);
+    free(palette);
+    free(jointslots);
+    free(vertcopy);
+    free(vertstamp);
+    free(vertowner);
+    free(vertjoints);
+    free(bindings);
 }
 
 //****************************************************************************
@@ -1206,9 +6918,12 @@ void taa_scenemesh_triangulate(
     taa_scenemesh* mesh)
 {
     uint32_t size;
+    uint32_t indexsize;
+    uint32_t alltris;
     uint32_t newnumfaces;
     uint32_t newnumindices;
     uint32_t* newindices;
+    uint32_t* indexitr;
     taa_scenemesh_face* newfaces;
     taa_scenemesh_face* tri;
     taa_scenemesh_binding* newbindings;
@@ -1216,91 +6931,116 @@ void taa_scenemesh_triangulate(
     const taa_scenemesh_binding* bindingsrcitr;
     const taa_scenemesh_binding* bindingsrcend;
 
-    size = sizeof(*newindices) * mesh->numindices;
-    newindices = (uint32_t*) malloc(size);
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    // count the output triangles so that each buffer is only sized once
+    indexsize = mesh->indexsize;
+    alltris = 1; // true
+    newnumfaces = 0;
+    bindingsrcitr = mesh->bindings;
+    bindingsrcend = bindingsrcitr + mesh->numbindings;
+    while(bindingsrcitr != bindingsrcend)
+    {
+        const taa_scenemesh_face* facesrc;
+        const taa_scenemesh_face* facesrcend;
+        facesrc = mesh->faces + bindingsrcitr->firstface;
+        facesrcend = facesrc + bindingsrcitr->numfaces;
+        while(facesrc != facesrcend)
+        {
+            assert(facesrc->numvertices>=3); // face needs more verts
+            newnumfaces += facesrc->numvertices - 2;
+            alltris &= (facesrc->numvertices == 3);
+            ++facesrc;
+        }
+        ++bindingsrcitr;
+    }
+    newnumindices = newnumfaces * 3 * indexsize;
+    // the index buffer can only be kept if the bindings reference all of
+    // it, otherwise it is rebuilt so that unbound faces are dropped
+    alltris &= (newnumindices == mesh->numindices);
 
-    size = sizeof(*newfaces) * mesh->numfaces;
+    // allocate the new buffers rounded up to the same capacities used by
+    // the resize functions, so faces may still be appended afterward
+    size = sizeof(*newfaces) * ((newnumfaces + 1023) & ~1023);
     newfaces = (taa_scenemesh_face*) malloc(size);
-
-    size = sizeof(*newbindings) * mesh->numbindings;
+    size = sizeof(*newbindings) * ((mesh->numbindings + 7) & ~7);
     newbindings = (taa_scenemesh_binding*) malloc(size);
+    newindices = NULL;
+    if(!alltris)
+    {
+        size = sizeof(*newindices) * ((newnumindices + 1023) & ~1023);
+        newindices = (uint32_t*) malloc(size);
+    }
 
-    newnumindices = 0;
-    newnumfaces = 0;
+    tri = newfaces;
+    indexitr = newindices;
     bindingitr = newbindings;
     bindingsrcitr = mesh->bindings;
-    bindingsrcend = bindingsrcitr + mesh->numbindings;
     while(bindingsrcitr != bindingsrcend)
     {
         const taa_scenemesh_face* facesrc;
         const taa_scenemesh_face* facesrcend;
 
-        strcpy(bindingitr->name, bindingsrcitr->name);
-        bindingitr->materialid = bindingsrcitr->materialid;
-        bindingitr->firstface = newnumfaces;
+        *bindingitr = *bindingsrcitr;
+        bindingitr->firstface = (uint32_t) (tri - newfaces);
+        bindingitr->numfaces = bindingsrcitr->numfaces;
 
         facesrc = mesh->faces + bindingsrcitr->firstface;
         facesrcend = facesrc + bindingsrcitr->numfaces;
-        while(facesrc != facesrcend)
+        if(alltris)
         {
-            const uint32_t* indexsrc0;
-            const uint32_t* indexsrc1;
-            const uint32_t* indexsrc2;
-            const uint32_t* indexsrcend;
-
-            assert(facesrc->numvertices>=3); // face needs more verts
+            // every face is already a triangle, so the index buffer can be
+            // kept as is and only the face records need to be gathered
+            size = sizeof(*tri) * bindingsrcitr->numfaces;
+            memcpy(tri, facesrc, size);
+            tri += bindingsrcitr->numfaces;
+        }
+        else
+        {
+            size = sizeof(*indexitr) * indexsize;
+            while(facesrc != facesrcend)
+            {
+                const uint32_t* indexsrc0;
+                const uint32_t* indexsrc1;
+                const uint32_t* indexsrcend;
 
-            // Create a triangle fan from the polygon
-            indexsrc0 = mesh->indices + facesrc->firstindex;
-            indexsrc1 = indexsrc0 + mesh->indexsize;
-            indexsrc2 = indexsrc1 + mesh->indexsize;
-            indexsrcend = indexsrc0 + facesrc->numindices;
-            while(indexsrc2 != indexsrcend)
-            {
-                uint32_t* indexitr;
-
-                // for each vertex after the second, create a new triangle
-                // from the first, the previous, and this vertex.
-                size = sizeof(*newfaces) * (++newnumfaces);
-                newfaces = (taa_scenemesh_face*) realloc(
-                    newfaces,
-                    size);
-                tri = newfaces + newnumfaces - 1;
-                tri->firstindex = newnumindices;
-                tri->numindices = 3 * mesh->indexsize;
-                tri->numvertices = 3;
-
-                // copy the indices into the new index buffer
-                newnumindices += tri->numindices;
-                size = sizeof(*newindices) * newnumindices;
-                newindices = (uint32_t*) realloc(
-                    newindices,
-                    size);
-                // first vert of the source face
-                indexitr = newindices + tri->firstindex;
-                size = sizeof(*indexitr) * mesh->indexsize;
-                memcpy(indexitr, indexsrc0, size);
-                // previous vert of the source face
-                indexitr += mesh->indexsize;
-                memcpy(indexitr, indexsrc1, size);
-                // current vert of the source face
-                indexitr += mesh->indexsize;
-                memcpy(indexitr, indexsrc2, size);
-
-                indexsrc1 += mesh->indexsize;
-                indexsrc2 += mesh->indexsize;
+                // Create a triangle fan from the polygon
+                indexsrc0 = mesh->indices + facesrc->firstindex;
+                indexsrc1 = indexsrc0 + indexsize;
+                indexsrcend = indexsrc0 + facesrc->numindices - indexsize;
+                while(indexsrc1 != indexsrcend)
+                {
+                    // for each vertex after the second, create a new
+                    // triangle from the first, the previous, and this vertex.
+                    tri->firstindex = (uint32_t) (indexitr - newindices);
+                    tri->numindices = 3 * indexsize;
+                    tri->numvertices = 3;
+                    ++tri;
+                    // first vert of the source face
+                    memcpy(indexitr, indexsrc0, size);
+                    indexitr += indexsize;
+                    // previous and current vert of the source face
+                    memcpy(indexitr, indexsrc1, size * 2);
+                    indexitr += indexsize * 2;
+                    indexsrc1 += indexsize;
+                }
+                ++facesrc;
             }
-            ++facesrc;
+            bindingitr->numfaces = (uint32_t) (tri - newfaces);
+            bindingitr->numfaces -= bindingitr->firstface;
         }
-        bindingitr->numfaces = newnumfaces - bindingitr->firstface;
 
         ++bindingitr;
         ++bindingsrcitr;
     }
+    assert(tri == newfaces + newnumfaces);
 
-    free(mesh->indices);
-    mesh->indices = newindices;
-    mesh->numindices = newnumindices;
+    if(!alltris)
+    {
+        assert(indexitr == newindices + newnumindices);
+        free(mesh->indices);
+        mesh->indices = newindices;
+        mesh->numindices = newnumindices;
+    }
 
     free(mesh->faces);
     mesh->faces = newfaces;
@@ -1314,3 +7054,229 @@ void taa_scenemesh_triangulate(
 #undef taa_FORMAT_NEWT
 #undef taa_FORMAT_SRCT
 #undef taa_FORMAT
+
+//****************************************************************************
+void taa_scenemesh_weld_vertices(
+    taa_scenemesh* mesh,
+    const float* tolerances)
+{
+    uint32_t* groupstreams;
+    uint32_t numwelded = 0;
+    uint32_t mapping;
+
+    assert(mesh->indexwidth == sizeof(*mesh->indices)); // not narrowed
+    groupstreams = (uint32_t*) malloc(
+        (mesh->numstreams + 1) * sizeof(*groupstreams));
+    for(mapping = 0; mapping < (uint32_t) mesh->indexsize; ++mapping)
+    {
+        // the streams sharing an index are welded together, so vertices
+        // only collapse when every one of their streams is within tolerance.
+        // indices with merged streams are left alone.
+        const taa_scenemesh_stream* keyvs = NULL;
+        uint32_t numgroup = 0;
+        uint32_t numverts = 0;
+        uint32_t numvalues = 0;
+        uint32_t keyoffset = 0;
+        uint32_t numkeys;
+        uint32_t hashsize;
+        uint32_t numreps;
+        uint32_t span;
+        float celltol;
+        float* values;
+        float* valuetols;
+        int32_t* cells;
+        uint32_t* hashtable;
+        uint32_t* remap;
+        uint32_t f;
+        uint32_t i;
+        uint32_t v;
+        for(i = 0; i < mesh->numstreams; ++i)
+        {
+            const taa_scenemesh_stream* vs = mesh->vertexstreams + i;
+            if(vs->indexmapping == mapping)
+            {
+                if(vs->usage == taa_SCENEMESH_USAGE_MERGED ||
+                   vs->valuetype == taa_SCENEMESH_VALUE_MERGED)
+                {
+                    // the layout of merged streams is unknown
+                    numgroup = 0;
+                    break;
+                }
+                if(numgroup == 0 || vs->usage == taa_SCENEMESH_USAGE_POSITION)
+                {
+                    // the grid is built over the positions if possible
+                    keyvs = vs;
+                    keyoffset = numvalues;
+                }
+                assert(numgroup == 0 || vs->numvertices == numverts);
+                numverts = vs->numvertices;
+                numvalues += vs->numcomponents;
+                groupstreams[numgroup] = i;
+                ++numgroup;
+            }
+        }
+        if(numgroup == 0 || numverts == 0)
+        {
+            continue;
+        }
+        numkeys = (keyvs->numcomponents < 3) ? keyvs->numcomponents : 3;
+        celltol = tolerances[keyvs->usage];
+        span = (celltol > 0.0f) ? 3 : 1;
+        hashsize = 16;
+        while(hashsize < numverts * 2)
+        {
+            hashsize <<= 1;
+        }
+        values = (float*) malloc(numverts * numvalues * sizeof(*values));
+        valuetols = (float*) malloc(numvalues * sizeof(*valuetols));
+        cells = (int32_t*) calloc(numverts * 3, sizeof(*cells));
+        hashtable = (uint32_t*) malloc(hashsize * sizeof(*hashtable));
+        remap = (uint32_t*) malloc(numverts * sizeof(*remap));
+        memset(hashtable, 0xff, hashsize * sizeof(*hashtable));
+        f = 0;
+        for(i = 0; i < numgroup; ++i)
+        {
+            const taa_scenemesh_stream* vs;
+            uint32_t c;
+            vs = mesh->vertexstreams + groupstreams[i];
+            for(v = 0; v < numverts; ++v)
+            {
+                float* dst = values + v*numvalues + f;
+                taa_scenemesh_read_floats(vs, v, dst, vs->numcomponents);
+            }
+            for(c = 0; c < vs->numcomponents; ++c)
+            {
+                valuetols[f + c] = tolerances[vs->usage];
+            }
+            f += vs->numcomponents;
+        }
+        // grid cells are as wide as the tolerance, so any match lies in
+        // one of the neighboring cells. With no tolerance, the cell is the
+        // exact value.
+        for(v = 0; v < numverts; ++v)
+        {
+            const float* key = values + v*numvalues + keyoffset;
+            uint32_t k;
+            for(k = 0; k < numkeys; ++k)
+            {
+                if(celltol > 0.0f)
+                {
+                    double q = floor(key[k] / celltol);
+                    q = (q < -1073741824.0) ? -1073741824.0 : q;
+                    q = (q >  1073741824.0) ?  1073741824.0 : q;
+                    cells[v*3 + k] = (int32_t) q;
+                }
+                else
+                {
+                    memcpy(cells + v*3 + k, key + k, sizeof(*key));
+                }
+            }
+        }
+
+        // each vertex collapses onto the first earlier vertex within
+        // tolerance, or becomes a representative itself
+        numreps = 0;
+        for(v = 0; v < numverts; ++v)
+        {
+            const float* vals = values + v*numvalues;
+            uint32_t rep = ~0U;
+            uint32_t probe;
+            uint32_t h;
+            for(probe = 0; probe < span*span*span && rep == ~0U; ++probe)
+            {
+                int32_t cell[3];
+                uint32_t digits = probe;
+                uint32_t k;
+                int skip = 0;
+                for(k = 0; k < 3; ++k)
+                {
+                    int32_t d = (int32_t) (digits%span) - (int32_t) (span/2);
+                    digits /= span;
+                    skip |= (k >= numkeys && d != 0);
+                    cell[k] = cells[v*3 + k] + d;
+                }
+                if(skip)
+                {
+                    continue;
+                }
+                h = taa_scenemesh_hash(cell, sizeof(cell)) & (hashsize - 1);
+                while(hashtable[h] != ~0U && rep == ~0U)
+                {
+                    uint32_t r = hashtable[h];
+                    if(!memcmp(cells + r*3, cell, sizeof(cell)))
+                    {
+                        const float* rvals = values + r*numvalues;
+                        uint32_t c = 0;
+                        while(c < numvalues &&
+                              fabsf(rvals[c] - vals[c]) <= valuetols[c])
+                        {
+                            ++c;
+                        }
+                        rep = (c == numvalues) ? r : ~0U;
+                    }
+                    h = (h + 1) & (hashsize - 1);
+                }
+            }
+            if(rep == ~0U)
+            {
+                // compact the representatives to the front of the streams
+                h = taa_scenemesh_hash(cells+v*3, 3*sizeof(*cells));
+                h &= hashsize - 1;
+                while(hashtable[h] != ~0U)
+                {
+                    h = (h + 1) & (hashsize - 1);
+                }
+                hashtable[h] = v;
+                remap[v] = numreps;
+                for(i = 0; i < numgroup && numreps != v; ++i)
+                {
+                    taa_scenemesh_stream* vs;
+                    vs = mesh->vertexstreams + groupstreams[i];
+                    memcpy(
+                        vs->buffer + numreps*vs->stride,
+                        vs->buffer + v*vs->stride,
+                        vs->stride);
+                }
+                ++numreps;
+            }
+            else
+            {
+                remap[v] = remap[rep];
+            }
+        }
+        if(numreps != numverts)
+        {
+            for(i = 0; i < numgroup; ++i)
+            {
+                taa_scenemesh_stream* vs;
+                vs = mesh->vertexstreams + groupstreams[i];
+                taa_scenemesh_resize_vertices(vs, vs->stride, numreps);
+            }
+            for(f = 0; f < mesh->numfaces; ++f)
+            {
+                const taa_scenemesh_face* face = mesh->faces + f;
+                uint32_t* indexitr = mesh->indices + face->firstindex;
+                uint32_t* indexend = indexitr + face->numindices;
+                indexitr += mapping;
+                while(indexitr < indexend)
+                {
+                    *indexitr = remap[*indexitr];
+                    indexitr += mesh->indexsize;
+                }
+            }
+            numwelded += numverts - numreps;
+        }
+        free(remap);
+        free(hashtable);
+        free(cells);
+        free(valuetols);
+        free(values);
+    }
+    if(numwelded > 0 && mesh->indexsize == 1)
+    {
+        // meshlets and lods reference the old vertices
+        taa_scenemesh_resize_meshlets(mesh, 0, 0, 0);
+        taa_scenemesh_resize_lods(mesh, 0, 0);
+    }
+    free(groupstreams);
+}